@@ -1,9 +1,37 @@
 ﻿#include <iostream>
 #include <vector>
 #include <string>
+#include <sstream>
 #include <algorithm>
 #include <ctime>
 #include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include <array>
+#include <limits>
+#include <cctype>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -12,346 +40,4082 @@ enum class PieceColor { WHITE, BLACK, NONE };
 enum class PlayerType { HUMAN, COMPUTER };
 const int BOARD_SIZE = 8;
 
+// ========== БИТБОРДЫ ==========
+// Доска хранится как набор 32-битных масок по 32 черным клеткам.
+// Клетка (row, col) имеет индекс row * 4 + col / 2: в четных строках
+// черные клетки стоят в нечетных столбцах, в нечетных строках - в четных.
+typedef uint32_t Bitboard;
+
+const int SQUARES = 32;
+const Bitboard EVEN_ROWS = 0x0F0F0F0Fu;        // Строки 0, 2, 4, 6
+const Bitboard ODD_ROWS = 0xF0F0F0F0u;         // Строки 1, 3, 5, 7
+const Bitboard EVEN_RIGHT_EDGE = 0x08080808u;  // Столбец 7 в четных строках
+const Bitboard ODD_LEFT_EDGE = 0x10101010u;    // Столбец 0 в нечетных строках
+const Bitboard ROW_0 = 0x0000000Fu;            // Строка превращения белых
+const Bitboard ROW_7 = 0xF0000000u;            // Строка превращения черных
+const Bitboard BLACK_START = 0x00000FFFu;      // Строки 0-2
+const Bitboard WHITE_START = 0xFFF00000u;      // Строки 5-7
+
+// Обязательное встраивание: функции ядра оценки должны встраиваться
+// в цикл по пакету позиций, иначе он не векторизуется
+#ifdef _MSC_VER
+#define FORCE_INLINE __forceinline
+#else
+#define FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+// Количество установленных битов
+inline int popCount(Bitboard b) {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt(b));
+#else
+    return __builtin_popcount(b);
+#endif
+}
+
+// Индекс младшего установленного бита (маска не должна быть пустой)
+inline int lowestBit(Bitboard b) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, b);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(b);
+#endif
+}
+
+// Перевод координат в индекс черной клетки (-1 для белых клеток и клеток вне доски)
+inline int squareIndex(int row, int col) {
+    if (row < 0 || row >= BOARD_SIZE || col < 0 || col >= BOARD_SIZE || (row + col) % 2 != 1) {
+        return -1;
+    }
+    return row * 4 + col / 2;
+}
+
+// Обратный перевод индекса клетки в координаты
+inline int squareRow(int sq) {
+    return sq / 4;
+}
+
+inline int squareCol(int sq) {
+    return (sq % 4) * 2 + ((sq / 4) % 2 == 0 ? 1 : 0);
+}
+
+// Сдвиги масок на одну клетку по диагонали ("вниз" - к строке 7)
+inline Bitboard shiftDownLeft(Bitboard b) {
+    return ((b & EVEN_ROWS) << 4) | ((b & ODD_ROWS & ~ODD_LEFT_EDGE) << 3);
+}
+
+inline Bitboard shiftDownRight(Bitboard b) {
+    return ((b & EVEN_ROWS & ~EVEN_RIGHT_EDGE) << 5) | ((b & ODD_ROWS) << 4);
+}
+
+inline Bitboard shiftUpLeft(Bitboard b) {
+    return ((b & EVEN_ROWS) >> 4) | ((b & ODD_ROWS & ~ODD_LEFT_EDGE) >> 5);
+}
+
+inline Bitboard shiftUpRight(Bitboard b) {
+    return ((b & EVEN_ROWS & ~EVEN_RIGHT_EDGE) >> 3) | ((b & ODD_ROWS) >> 4);
+}
+
+// Поворот доски на 180 градусов (клетка s переходит в 31 - s): позиция черных
+// выглядит как позиция белых
+FORCE_INLINE Bitboard flipBoard(Bitboard b) {
+    b = ((b >> 1) & 0x55555555u) | ((b & 0x55555555u) << 1);
+    b = ((b >> 2) & 0x33333333u) | ((b & 0x33333333u) << 2);
+    b = ((b >> 4) & 0x0F0F0F0Fu) | ((b & 0x0F0F0F0Fu) << 4);
+    b = ((b >> 8) & 0x00FF00FFu) | ((b & 0x00FF00FFu) << 8);
+    return (b >> 16) | (b << 16);
+}
+
+// Сдвиг маски в направлении (row_step, col_step), где шаги равны +1 или -1
+inline Bitboard shiftDiagonal(Bitboard b, int row_step, int col_step) {
+    if (row_step > 0) {
+        return col_step > 0 ? shiftDownRight(b) : shiftDownLeft(b);
+    }
+    return col_step > 0 ? shiftUpRight(b) : shiftUpLeft(b);
+}
+
+// ========== ХЕШИРОВАНИЕ ЗОБРИСТА ==========
+// Псевдослучайная последовательность splitmix64 (фиксированное начальное значение,
+// чтобы ключи и результаты поиска были одинаковыми при каждом запуске)
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Ключи для каждого вида шашки на каждой клетке и для очереди хода черных
+struct ZobristKeys {
+    uint64_t white_men[SQUARES];
+    uint64_t white_kings[SQUARES];
+    uint64_t black_men[SQUARES];
+    uint64_t black_kings[SQUARES];
+    uint64_t black_to_move;
+
+    ZobristKeys() {
+        uint64_t state = 0x53484153484B49ull;
+        for (int sq = 0; sq < SQUARES; ++sq) {
+            white_men[sq] = splitMix64(state);
+            white_kings[sq] = splitMix64(state);
+            black_men[sq] = splitMix64(state);
+            black_kings[sq] = splitMix64(state);
+        }
+        black_to_move = splitMix64(state);
+    }
+
+    // Сумма (XOR) ключей всех клеток маски
+    static uint64_t of(const uint64_t* keys, Bitboard b) {
+        uint64_t key = 0;
+        for (; b != 0; b &= b - 1) {
+            key ^= keys[lowestBit(b)];
+        }
+        return key;
+    }
+};
+
+const ZobristKeys ZOBRIST;
+
 // ========== СТРУКТУРЫ ДАННЫХ ==========
 struct Piece {
     PieceColor color;
     bool is_king;
 
-    Piece(PieceColor c = PieceColor::NONE, bool king = false)
-        : color(c), is_king(king) {
+    Piece(PieceColor c = PieceColor::NONE, bool king = false)
+        : color(c), is_king(king) {
+    }
+};
+
+// Ход в компактном виде: клетки задаются индексами 0..31
+struct Move {
+    Bitboard captured;   // Маска взятых шашек противника
+    uint8_t from;        // Начальная клетка
+    uint8_t to;          // Конечная клетка
+    bool promotion;      // Превращение в дамку
+
+    Move(int f = 0, int t = 0, Bitboard c = 0, bool promote = false)
+        : captured(c), from(static_cast<uint8_t>(f)), to(static_cast<uint8_t>(t)), promotion(promote) {
+    }
+
+    bool isCapture() const {
+        return captured != 0;
+    }
+};
+
+// Список ходов фиксированного размера, размещаемый на стеке
+const int MAX_MOVES = 256;
+
+struct MoveList {
+    Move moves[MAX_MOVES];
+    int count = 0;
+
+    void clear() {
+        count = 0;
+    }
+
+    void add(const Move& move) {
+        moves[count++] = move;
+    }
+
+    int size() const {
+        return count;
+    }
+
+    // Удаление первых n ходов с сохранением порядка остальных
+    void removeFront(int n) {
+        if (n > 0) {
+            copy(moves + n, moves + count, moves);
+            count -= n;
+        }
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    const Move& operator[](int i) const {
+        return moves[i];
+    }
+
+    const Move* begin() const {
+        return moves;
+    }
+
+    const Move* end() const {
+        return moves + count;
+    }
+};
+
+// Запись хода в числовой нотации: клетки нумеруются 1..32 слева направо
+// и сверху вниз (клетка 1 - (0,1)), "-" - тихий ход, "x" - взятие
+string moveToString(const Move& move) {
+    return to_string(move.from + 1) + (move.isCapture() ? "x" : "-") + to_string(move.to + 1);
+}
+
+// Начальная позиция в формате FEN (PDN): очередь хода, затем списки клеток
+// белых и черных шашек; "K" перед номером - дамка, "a-b" - диапазон клеток
+const char* const START_FEN = "W:W21-32:B1-12";
+
+// Диагональные направления (row_step, col_step)
+const int DIRECTIONS[4][2] = { {-1, -1}, {-1, 1}, {1, -1}, {1, 1} };
+
+// Ничья: 15 ходов подряд (30 полуходов) только дамками без взятий
+const int DRAW_KING_PLIES = 30;
+
+const int MAN_VALUE = 100;   // Стоимость простой шашки
+const int KING_VALUE = 300;  // Стоимость дамки
+
+// Данные для отмены хода
+struct Undo {
+    Move move;                  // Сделанный ход
+    Bitboard captured_kings;    // Какие из взятых шашек были дамками
+    bool king_move;             // Ходила дамка
+    int reversible_plies;       // Счетчик правила ничьей до хода
+    uint64_t hash;              // Ключ позиции до хода
+};
+
+class CheckersBoard;
+class Engine;
+struct Limits;
+struct SearchResult;
+
+// Наблюдатель за ходом партии. Доска сама ничего не выводит: интерфейс
+// (консоль, сервер) получает события через наблюдателя, а в поиске
+// и матчах наблюдатель не задан, и события ничего не стоят.
+class GameObserver {
+public:
+    virtual ~GameObserver() {}
+    
+    // Сделан ход (доска уже в позиции после хода)
+    virtual void onMove(const CheckersBoard&, const Move&, PieceColor /*mover*/) {}
+    
+    // Шашка превратилась в дамку
+    virtual void onPromotion(const CheckersBoard&, const Move&) {}
+    
+    // Компьютер выбрал ход; вызывается до его выполнения (доска еще в позиции до хода),
+    // поэтому приходит раньше onMove и onGameOver этого хода
+    virtual void onComputerMove(const CheckersBoard&, const Move&, const SearchResult&) {}
+    
+    // Партия окончена (победитель - getWinner())
+    virtual void onGameOver(const CheckersBoard&) {}
+};
+
+// ========== КЛАСС ИГРОВОЙ ДОСКИ ==========
+class CheckersBoard {
+private:
+static const int SIZE = 8;  // Размер доски (8x8)
+    Bitboard white_men;          // Простые белые шашки
+    Bitboard white_kings;        // Белые дамки
+    Bitboard black_men;          // Простые черные шашки
+    Bitboard black_kings;        // Черные дамки
+    PieceColor current_player;    // Текущий игрок (чей ход)
+    bool game_over;              // Флаг окончания игры
+    PieceColor winner;           // Победитель (NONE - ничья или игра не окончена)
+    int reversible_plies;        // Полуходы подряд только дамками без взятий
+    uint64_t hash;               // Ключ Зобриста текущей позиции
+    PlayerType white_player;     // Тип игрока для белых
+    PlayerType black_player;     // Тип игрока для черных
+    GameObserver* observer;      // Получатель событий партии (может отсутствовать)
+
+    // Все шашки указанного цвета
+    Bitboard piecesOf(PieceColor color) const {
+        return color == PieceColor::WHITE ? (white_men | white_kings) : (black_men | black_kings);
+    }
+
+    // Все занятые клетки
+    Bitboard occupied() const {
+        return white_men | white_kings | black_men | black_kings;
+    }
+
+    // Неизменные на время генерации данные для поиска серий взятий
+    struct CaptureContext {
+        Bitboard enemy;          // Шашки противника
+        Bitboard empty;          // Пустые клетки (включая исходную клетку бьющей шашки)
+        Bitboard promotion_row;  // Строка превращения в дамку
+        int from;                // Исходная клетка бьющей шашки
+    };
+
+    // Рекурсивный поиск продолжений серии взятий с клетки pos.
+    // Взятые шашки остаются на доске до конца хода: их нельзя перепрыгнуть повторно.
+    // Разные пути с одинаковым результатом считаются разными ходами (как в perft).
+    // Возвращает true, если с этой клетки есть хотя бы одно взятие.
+    bool addCaptureSequences(MoveList& list, const CaptureContext& ctx, Bitboard pos,
+                             Bitboard captured, bool is_king, bool promoted) const {
+        bool found = false;
+        Bitboard capturable = ctx.enemy & ~captured;
+        for (const auto& dir : DIRECTIONS) {
+            Bitboard b = shiftDiagonal(pos, dir[0], dir[1]);
+            // Дамка может подойти к шашке противника с любого расстояния
+            if (is_king) {
+                while (b & ctx.empty) {
+                    b = shiftDiagonal(b, dir[0], dir[1]);
+                }
+            }
+            if (!(b & capturable)) {
+                continue;
+            }
+            Bitboard victim = b;
+            Bitboard landing = shiftDiagonal(victim, dir[0], dir[1]);
+            if (!(landing & ctx.empty)) {
+                continue;
+            }
+            found = true;
+            
+            // Простая шашка бьет (и вперед, и назад) только на соседнюю клетку за шашкой противника
+            if (!is_king) {
+                bool crowned = (landing & ctx.promotion_row) != 0;
+                // Шашка, ставшая дамкой, продолжает бить уже как дамка
+                if (!addCaptureSequences(list, ctx, landing, captured | victim, crowned, crowned)) {
+                    list.add(Move(ctx.from, lowestBit(landing), captured | victim, crowned));
+                }
+                continue;
+            }
+            
+            // Дамка выбирает любое поле за взятой шашкой, но если с некоторых
+            // из них взятие можно продолжить, она обязана выбрать одно из них
+            bool continued = false;
+            for (Bitboard l = landing; l & ctx.empty; l = shiftDiagonal(l, dir[0], dir[1])) {
+                if (addCaptureSequences(list, ctx, l, captured | victim, true, promoted)) {
+                    continued = true;
+                }
+            }
+            if (!continued) {
+                for (Bitboard l = landing; l & ctx.empty; l = shiftDiagonal(l, dir[0], dir[1])) {
+                    list.add(Move(ctx.from, lowestBit(l), captured | victim, promoted));
+                }
+            }
+        }
+        return found;
+    }
+
+    // Поиск серии взятий, которая берет ровно шашки move.captured и заканчивается на move.to.
+    // path - поля остановки после каждого взятия; wanted (если не пуст) задает эти поля.
+    bool traceCapture(const CaptureContext& ctx, const Move& move, const vector<int>& wanted, Bitboard pos,
+                      Bitboard captured, bool is_king, vector<int>& path) const {
+        if (captured == move.captured) {
+            return pos == (Bitboard(1) << move.to);
+        }
+        Bitboard capturable = move.captured & ~captured;
+        for (const auto& dir : DIRECTIONS) {
+            Bitboard b = shiftDiagonal(pos, dir[0], dir[1]);
+            if (is_king) {
+                while (b & ctx.empty) {
+                    b = shiftDiagonal(b, dir[0], dir[1]);
+                }
+            }
+            if (!(b & capturable)) {
+                continue;
+            }
+            // Простая шашка встает сразу за взятой, дамка - на любое свободное поле за ней
+            for (Bitboard l = shiftDiagonal(b, dir[0], dir[1]); l & ctx.empty; l = shiftDiagonal(l, dir[0], dir[1])) {
+                int square = lowestBit(l);
+                if (wanted.empty() || wanted[path.size()] == square) {
+                    path.push_back(square);
+                    bool crowned = is_king || (l & ctx.promotion_row) != 0;
+                    if (traceCapture(ctx, move, wanted, l, captured | b, crowned, path)) {
+                        return true;
+                    }
+                    path.pop_back();
+                }
+                if (!is_king) {
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Проверка окончания игры после хода игрока mover
+    void updateGameState(PieceColor mover) {
+        MoveList replies;
+        generateMoves(replies);
+        // Игрок, которому нечем ходить (в том числе без шашек), проигрывает
+        if (replies.empty()) {
+            game_over = true;
+            winner = mover;
+        } else if (reversible_plies >= DRAW_KING_PLIES) {
+            game_over = true;
+            winner = PieceColor::NONE;
+        }
+    }
+
+public:
+    // Конструктор
+    CheckersBoard(PlayerType white = PlayerType::HUMAN,
+        PlayerType black = PlayerType::COMPUTER)
+        : current_player(PieceColor::WHITE), // Белые ходят первыми
+          game_over(false),                 // Игра только начинается
+          winner(PieceColor::NONE),         // Победителя пока нет
+          reversible_plies(0),              // Счетчик ходов дамками
+          white_player(white),              // Установка типа игрока для белых
+          black_player(black),              // Установка типа игрока для черных
+          observer(nullptr) {               // События никому не передаются
+        setupBoard();                            // Начальная расстановка шашек
+    }
+
+    // Настройка начальной позиции
+    void setupBoard() {
+        // Первые 3 ряда - черные шашки, последние 3 ряда - белые,
+        // средние 2 ряда и все белые клетки пусты
+        black_men = BLACK_START;
+        white_men = WHITE_START;
+        black_kings = 0;
+        white_kings = 0;
+        hash = computeHash();
+    }
+    
+    // Полный пересчет ключа позиции (в ходе игры ключ обновляется по разнице)
+    uint64_t computeHash() const {
+        uint64_t key = ZobristKeys::of(ZOBRIST.white_men, white_men)
+                     ^ ZobristKeys::of(ZOBRIST.white_kings, white_kings)
+                     ^ ZobristKeys::of(ZOBRIST.black_men, black_men)
+                     ^ ZobristKeys::of(ZOBRIST.black_kings, black_kings);
+        return current_player == PieceColor::BLACK ? key ^ ZOBRIST.black_to_move : key;
+    }
+
+    // Установка позиции из FEN. При ошибке разбора позиция не меняется и возвращается false.
+    bool setPosition(const string& fen) {
+        Bitboard men[2] = { 0, 0 };     // Белые, черные
+        Bitboard kings[2] = { 0, 0 };
+        stringstream input(fen);
+        string side, field;
+        if (!getline(input, side, ':') || (side != "W" && side != "B")) {
+            return false;
+        }
+        while (getline(input, field, ':')) {
+            if (field.empty() || (field[0] != 'W' && field[0] != 'B')) {
+                return false;
+            }
+            int color = (field[0] == 'W') ? 0 : 1;
+            stringstream squares(field.substr(1));
+            string item;
+            while (getline(squares, item, ',')) {
+                bool king = !item.empty() && item[0] == 'K';
+                if (king) {
+                    item = item.substr(1);
+                }
+                size_t dash = item.find('-');
+                int first = atoi(item.substr(0, dash).c_str());
+                int last = (dash == string::npos) ? first : atoi(item.substr(dash + 1).c_str());
+                if (first < 1 || last > SQUARES || first > last) {
+                    return false;
+                }
+                for (int num = first; num <= last; ++num) {
+                    Bitboard bit = Bitboard(1) << (num - 1);
+                    if ((men[0] | men[1] | kings[0] | kings[1]) & bit) {
+                        return false;
+                    }
+                    (king ? kings : men)[color] |= bit;
+                }
+            }
+        }
+        // Простая шашка не может стоять на своей строке превращения
+        if ((men[0] & ROW_0) || (men[1] & ROW_7)) {
+            return false;
+        }
+        setPieces(men[0], kings[0], men[1], kings[1], (side == "W") ? PieceColor::WHITE : PieceColor::BLACK);
+        return true;
+    }
+    
+    // Установка позиции по маскам шашек (маски не должны пересекаться)
+    void setPieces(Bitboard w_men, Bitboard w_kings, Bitboard b_men, Bitboard b_kings, PieceColor side) {
+        white_men = w_men;
+        white_kings = w_kings;
+        black_men = b_men;
+        black_kings = b_kings;
+        current_player = side;
+        game_over = false;
+        winner = PieceColor::NONE;
+        reversible_plies = 0;
+        hash = computeHash();
+    }
+    
+    // Запись позиции в формате FEN
+    string toFen() const {
+        string fen = (current_player == PieceColor::WHITE) ? "W" : "B";
+        for (int color = 0; color < 2; ++color) {
+            Bitboard men = color == 0 ? white_men : black_men;
+            Bitboard kings = color == 0 ? white_kings : black_kings;
+            fen += color == 0 ? ":W" : ":B";
+            bool first = true;
+            for (Bitboard b = men | kings; b != 0; b &= b - 1) {
+                int sq = lowestBit(b);
+                fen += first ? "" : ",";
+                fen += ((kings >> sq) & 1) ? "K" : "";
+                fen += to_string(sq + 1);
+                first = false;
+            }
+        }
+        return fen;
+    }
+    
+    // Шашка на клетке (row, col) - адаптер к координатному интерфейсу
+    Piece pieceAt(int row, int col) const {
+        int sq = squareIndex(row, col);
+        if (sq < 0) {
+            return Piece(PieceColor::NONE);
+        }
+        Bitboard bit = Bitboard(1) << sq;
+        if ((white_men | white_kings) & bit) {
+            return Piece(PieceColor::WHITE, (white_kings & bit) != 0);
+        }
+        if ((black_men | black_kings) & bit) {
+            return Piece(PieceColor::BLACK, (black_kings & bit) != 0);
+        }
+        return Piece(PieceColor::NONE);
+    }
+
+    // Количество шашек указанного цвета
+    int countPieces(PieceColor color) const {
+        return popCount(piecesOf(color));
+    }
+
+    // Метод для проверки, находится ли клетка в пределах доски
+    bool isOnBoard(int row, int col) const {
+        return row >= 0 && row < SIZE && col >= 0 && col < SIZE;
+    }
+    
+    // Генерация всех допустимых ходов текущего игрока за один проход по его шашкам.
+    // Взятие обязательно: после первого найденного взятия простые ходы
+    // отбрасываются, и в список попадают только взятия. Серия взятий
+    // записывается как один ход с маской всех взятых шашек.
+    void generateMoves(MoveList& list) const {
+        list.clear();
+        bool white = (current_player == PieceColor::WHITE);
+        Bitboard own = piecesOf(current_player);
+        Bitboard kings = white ? white_kings : black_kings;
+        int forward = white ? -1 : 1;
+        CaptureContext ctx;
+        ctx.enemy = white ? (black_men | black_kings) : (white_men | white_kings);
+        ctx.promotion_row = white ? ROW_0 : ROW_7;
+        Bitboard empty = ~(own | ctx.enemy);
+        bool capture_found = false;
+        
+        for (Bitboard pieces = own; pieces != 0; pieces &= pieces - 1) {
+            int from = lowestBit(pieces);
+            Bitboard from_bit = Bitboard(1) << from;
+            bool is_king = (kings & from_bit) != 0;
+            
+            // Сначала ищем серии взятий этой шашкой
+            int quiet_count = capture_found ? 0 : list.size();
+            ctx.from = from;
+            ctx.empty = empty | from_bit;
+            if (addCaptureSequences(list, ctx, from_bit, 0, is_king, false)) {
+                // Первое взятие: отбрасываем записанные до него простые ходы
+                list.removeFront(quiet_count);
+                capture_found = true;
+            }
+            if (capture_found) {
+                continue;
+            }
+            
+            // Простые ходы: дамка - на любое расстояние, шашка - на одну клетку вперед
+            if (is_king) {
+                for (const auto& dir : DIRECTIONS) {
+                    for (Bitboard b = shiftDiagonal(from_bit, dir[0], dir[1]); b & empty; b = shiftDiagonal(b, dir[0], dir[1])) {
+                        list.add(Move(from, lowestBit(b)));
+                    }
+                }
+            } else {
+                for (int col_step = -1; col_step <= 1; col_step += 2) {
+                    Bitboard b = shiftDiagonal(from_bit, forward, col_step);
+                    if (b & empty) {
+                        list.add(Move(from, lowestBit(b), 0, (b & ctx.promotion_row) != 0));
+                    }
+                }
+            }
+        }
+    }
+    
+    // Допустимые ходы с клетки from на клетку to, различные по взятым шашкам.
+    // Больше одного - взятие неоднозначно, его уточняют поля остановки (capturePath).
+    void movesBetween(const MoveList& list, int from, int to, MoveList& found) const {
+        found.clear();
+        for (const Move& move : list) {
+            if (move.from != from || move.to != to) {
+                continue;
+            }
+            bool known = false;
+            for (const Move& other : found) {
+                known = known || other.captured == move.captured;
+            }
+            if (!known) {
+                found.add(move);
+            }
+        }
+    }
+    
+    // Поля остановки серии взятий move: после каждой взятой шашки, последнее - move.to.
+    // Если wanted не пуст, серия должна проходить именно через эти поля.
+    // false, если move - не взятие или такой серии нет.
+    bool capturePath(const Move& move, const vector<int>& wanted, vector<int>& path) const {
+        path.clear();
+        if (!move.isCapture() || (!wanted.empty() && int(wanted.size()) != popCount(move.captured))) {
+            return false;
+        }
+        bool white = (current_player == PieceColor::WHITE);
+        Bitboard from_bit = Bitboard(1) << move.from;
+        CaptureContext ctx;
+        ctx.enemy = white ? (black_men | black_kings) : (white_men | white_kings);
+        ctx.empty = ~occupied() | from_bit;
+        ctx.promotion_row = white ? ROW_0 : ROW_7;
+        ctx.from = move.from;
+        bool is_king = ((white ? white_kings : black_kings) & from_bit) != 0;
+        return traceCapture(ctx, move, wanted, from_bit, 0, is_king, path);
+    }
+    
+    // Поиск допустимого хода по координатам (nullptr, если такого хода нет
+    // или взятие с этими клетками неоднозначно - см. movesBetween)
+    const Move* findMove(const MoveList& list, int from_row, int from_col, int to_row, int to_col) const {
+        MoveList found;
+        movesBetween(list, squareIndex(from_row, from_col), squareIndex(to_row, to_col), found);
+        if (found.size() != 1) {
+            return nullptr;
+        }
+        for (const Move& move : list) {
+            if (move.from == found[0].from && move.to == found[0].to) {
+                return &move;
+            }
+        }
+        return nullptr;
+    }
+    
+    // Метод для проверки валидности хода
+    bool isValidMove(int from_row, int from_col, int to_row, int to_col) {
+        MoveList list;
+        generateMoves(list);
+        return findMove(list, from_row, from_col, to_row, to_col) != nullptr;
+    }
+    
+    // Выполнение хода из списка допустимых с сохранением данных для отмены.
+    // Ключ позиции обновляется по разнице, без пересчета доски.
+    void doMove(const Move& move, Undo& undo) {
+        Bitboard from_bit = Bitboard(1) << move.from;
+        Bitboard to_bit = Bitboard(1) << move.to;
+        bool white = (current_player == PieceColor::WHITE);
+        Bitboard& men = white ? white_men : black_men;
+        Bitboard& kings = white ? white_kings : black_kings;
+        Bitboard& enemy_men = white ? black_men : white_men;
+        Bitboard& enemy_kings = white ? black_kings : white_kings;
+        
+        undo.move = move;
+        undo.captured_kings = enemy_kings & move.captured;
+        undo.king_move = (kings & from_bit) != 0;
+        undo.reversible_plies = reversible_plies;
+        undo.hash = hash;
+        
+        const uint64_t* men_keys = white ? ZOBRIST.white_men : ZOBRIST.black_men;
+        const uint64_t* king_keys = white ? ZOBRIST.white_kings : ZOBRIST.black_kings;
+        
+        // Перемещение шашки на новую позицию (дамка может вернуться
+        // на исходную клетку после серии взятий)
+        if (undo.king_move) {
+            kings = (kings & ~from_bit) | to_bit;
+            hash ^= king_keys[move.from] ^ king_keys[move.to];
+        } else if (move.promotion) {
+            men &= ~from_bit;
+            kings |= to_bit;
+            hash ^= men_keys[move.from] ^ king_keys[move.to];
+        } else {
+            men = (men & ~from_bit) | to_bit;
+            hash ^= men_keys[move.from] ^ men_keys[move.to];
+        }
+        
+        // Удаление взятых шашек противника
+        if (move.captured != 0) {
+            hash ^= ZobristKeys::of(white ? ZOBRIST.black_men : ZOBRIST.white_men, move.captured & ~undo.captured_kings)
+                  ^ ZobristKeys::of(white ? ZOBRIST.black_kings : ZOBRIST.white_kings, undo.captured_kings);
+            enemy_men &= ~move.captured;
+            enemy_kings &= ~move.captured;
+        }
+        hash ^= ZOBRIST.black_to_move;
+        
+        // Счетчик для правила ничьей: только ходы дамками без взятий
+        reversible_plies = (undo.king_move && !move.isCapture()) ? reversible_plies + 1 : 0;
+        
+        // Смена текущего игрока
+        current_player = white ? PieceColor::BLACK : PieceColor::WHITE;
+    }
+    
+    // Отмена хода, сделанного doMove
+    void undoMove(const Undo& undo) {
+        const Move& move = undo.move;
+        current_player = (current_player == PieceColor::WHITE) ? PieceColor::BLACK : PieceColor::WHITE;
+        bool white = (current_player == PieceColor::WHITE);
+        Bitboard& men = white ? white_men : black_men;
+        Bitboard& kings = white ? white_kings : black_kings;
+        Bitboard from_bit = Bitboard(1) << move.from;
+        Bitboard to_bit = Bitboard(1) << move.to;
+        
+        // Возврат шашки на исходную клетку
+        if (undo.king_move) {
+            kings = (kings & ~to_bit) | from_bit;
+        } else if (move.promotion) {
+            kings &= ~to_bit;
+            men |= from_bit;
+        } else {
+            men = (men & ~to_bit) | from_bit;
+        }
+        
+        // Возврат взятых шашек противника
+        if (white) {
+            black_kings |= undo.captured_kings;
+            black_men |= move.captured & ~undo.captured_kings;
+        } else {
+            white_kings |= undo.captured_kings;
+            white_men |= move.captured & ~undo.captured_kings;
+        }
+        
+        reversible_plies = undo.reversible_plies;
+        hash = undo.hash;
+    }
+    
+    // Выполнение хода без возможности отмены (без вывода в консоль)
+    void applyMove(const Move& move) {
+        Undo undo;
+        doMove(move, undo);
+    }
+    
+    // Выполнение хода в партии с проверкой окончания игры и оповещением наблюдателя
+    void commitMove(const Move& move) {
+        PieceColor mover = current_player;
+        applyMove(move);
+        updateGameState(mover);
+        if (observer != nullptr) {
+            observer->onMove(*this, move, mover);
+            if (move.promotion) {
+                observer->onPromotion(*this, move);
+            }
+            if (game_over) {
+                observer->onGameOver(*this);
+            }
+        }
+    }
+    
+    // Подписка наблюдателя на события партии (nullptr - отписка)
+    void setObserver(GameObserver* game_observer) {
+        observer = game_observer;
+    }
+    
+    // Метод для выполнения хода
+    bool makeMove(int from_row, int from_col, int to_row, int to_col) {
+        MoveList list;
+        generateMoves(list);
+        // Проверка валидности хода
+        const Move* move = findMove(list, from_row, from_col, to_row, to_col);
+        if (move == nullptr) {
+            return false;
+        }
+        commitMove(*move);
+        return true;
+    }
+    
+    // Метод для выполнения хода компьютером (определен после класса Engine)
+    void makeComputerMove(Engine& engine, const Limits& limits);
+    
+    // Геттер для текущего игрока
+    PieceColor getCurrentPlayer() const {
+        return current_player;
+    }
+    
+    // Геттер для типа текущего игрока (человек/компьютер)
+    PlayerType getCurrentPlayerType() const {
+        return (current_player == PieceColor::WHITE) ? white_player : black_player;
+    }
+    
+    // Геттер для проверки окончания игры
+    bool isGameOver() const {
+        return game_over;
+    }
+    
+    // Геттер для победителя (NONE - ничья или игра еще идет)
+    PieceColor getWinner() const {
+        return winner;
+    }
+    
+    // Ключ Зобриста текущей позиции
+    uint64_t getHash() const {
+        return hash;
+    }
+    
+    // Геттер для счетчика правила ничьей
+    int getReversiblePlies() const {
+        return reversible_plies;
+    }
+    
+    // Простые шашки указанного цвета
+    Bitboard menOf(PieceColor color) const {
+        return color == PieceColor::WHITE ? white_men : black_men;
+    }
+    
+    // Дамки указанного цвета
+    Bitboard kingsOf(PieceColor color) const {
+        return color == PieceColor::WHITE ? white_kings : black_kings;
+    }
+};
+
+// ========== ОЦЕНКА ПОЗИЦИИ ==========
+// Оценка - сумма признаков позиции с весами. Признаки каждой стороны
+// считаются в ориентации белых (позиция черных поворачивается на 180 градусов)
+// только сдвигами масок и подсчетом битов, без ветвлений. Поэтому одно ядро
+// оценивает и одну позицию, и пакет позиций, который компилятор векторизует.
+
+// Признаки оценки (разность белых и черных)
+enum EvalTerm {
+    TERM_MAN,           // Простые шашки
+    TERM_KING,          // Дамки
+    TERM_ADVANCE,       // Продвижение простых: сумма пройденных строк
+    TERM_CENTER,        // Шашки в центре доски
+    TERM_BACK_RANK,     // Простые на своей первой строке (защита от превращения)
+    TERM_MOBILITY,      // Свободные соседние клетки по направлениям хода
+    TERM_TEMPO,         // Право хода: +1, если ходят белые, иначе -1
+    EVAL_TERMS
+};
+
+const char* const EVAL_TERM_NAMES[EVAL_TERMS] = { "man", "king", "advance", "center", "back_rank", "mobility", "tempo" };
+
+const Bitboard CENTER = 0x00066000u;  // Клетки (3,2), (3,4), (4,3), (4,5)
+const Bitboard ROW_BIT_0 = 0xF0F0F0F0u;  // Строки с установленным битом 0 номера (нечетные)
+const Bitboard ROW_BIT_1 = 0xFF00FF00u;  // Бит 1: строки 2, 3, 6, 7
+const Bitboard ROW_BIT_2 = 0xFFFF0000u;  // Бит 2: строки 4-7
+const int EVAL_LIMIT = 20000;         // Оценка ограничена, чтобы не совпасть с оценкой выигрыша
+
+// Циклы по признакам разворачиваются, иначе цикл по пакету не векторизуется
+#if defined(__GNUC__) && !defined(__clang__)
+#define UNROLL_TERMS _Pragma("GCC unroll 8")
+#else
+#define UNROLL_TERMS
+#endif
+
+// Подсчет битов сдвигами и сложениями: векторизуется, в отличие от popcnt.
+// Сумма байтов собирается сдвигами, а не умножением - иначе компилятор
+// узнает в коде popcount и векторизовать его без AVX-512 не сможет.
+FORCE_INLINE int popCountSwar(Bitboard b) {
+    b = b - ((b >> 1) & 0x55555555u);
+    b = (b & 0x33333333u) + ((b >> 2) & 0x33333333u);
+    b = (b + (b >> 4)) & 0x0F0F0F0Fu;
+    b = b + (b >> 8);
+    b = b + (b >> 16);
+    return int(b & 0x3Fu);
+}
+
+// Признаки одной стороны, которая ходит вверх (к строке 0)
+template <int (*COUNT)(Bitboard)>
+FORCE_INLINE void sideTerms(Bitboard men, Bitboard kings, Bitboard empty, int terms[EVAL_TERMS]) {
+    Bitboard pieces = men | kings;
+    terms[TERM_MAN] = COUNT(men);
+    terms[TERM_KING] = COUNT(kings);
+    // Шашка в строке r прошла 7 - r строк; сумма номеров строк - по битам номера строки
+    int rows = COUNT(men & ROW_BIT_0) + 2 * COUNT(men & ROW_BIT_1) + 4 * COUNT(men & ROW_BIT_2);
+    terms[TERM_ADVANCE] = 7 * terms[TERM_MAN] - rows;
+    terms[TERM_CENTER] = COUNT(pieces & CENTER);
+    terms[TERM_BACK_RANK] = COUNT(men & ROW_7);
+    terms[TERM_MOBILITY] = COUNT(shiftUpLeft(pieces) & empty) + COUNT(shiftUpRight(pieces) & empty)
+                         + COUNT(shiftDownLeft(kings) & empty) + COUNT(shiftDownRight(kings) & empty);
+    terms[TERM_TEMPO] = 0;
+}
+
+// Признаки позиции: разность белых и черных
+template <int (*COUNT)(Bitboard)>
+FORCE_INLINE void evalFeatures(Bitboard white_men, Bitboard white_kings, Bitboard black_men, Bitboard black_kings,
+                         int black_to_move, int features[EVAL_TERMS]) {
+    Bitboard empty = ~(white_men | white_kings | black_men | black_kings);
+    int white[EVAL_TERMS];
+    int black[EVAL_TERMS];
+    sideTerms<COUNT>(white_men, white_kings, empty, white);
+    sideTerms<COUNT>(flipBoard(black_men), flipBoard(black_kings), flipBoard(empty), black);
+    UNROLL_TERMS
+    for (int t = 0; t < EVAL_TERMS; ++t) {
+        features[t] = white[t] - black[t];
+    }
+    features[TERM_TEMPO] = 1 - 2 * black_to_move;
+}
+
+inline void evalFeatures(const CheckersBoard& board, int features[EVAL_TERMS]) {
+    evalFeatures<popCount>(board.menOf(PieceColor::WHITE), board.kingsOf(PieceColor::WHITE),
+                           board.menOf(PieceColor::BLACK), board.kingsOf(PieceColor::BLACK),
+                           board.getCurrentPlayer() == PieceColor::BLACK ? 1 : 0, features);
+}
+
+// Веса признаков. Файл весов - строки "имя значение", '#' - комментарий;
+// не указанные в файле веса остаются прежними.
+struct EvalWeights {
+    int values[EVAL_TERMS] = { MAN_VALUE, KING_VALUE, 2, 4, 4, 1, 3 };
+
+    bool load(const string& path) {
+        ifstream file(path);
+        if (!file) {
+            return false;
+        }
+        string line;
+        while (getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            istringstream fields(line);
+            string name;
+            int value;
+            if (!(fields >> name)) {
+                continue;
+            }
+            int term = int(find(EVAL_TERM_NAMES, EVAL_TERM_NAMES + EVAL_TERMS, name) - EVAL_TERM_NAMES);
+            if (term == EVAL_TERMS || !(fields >> value)) {
+                return false;
+            }
+            values[term] = value;
+        }
+        return true;
+    }
+
+    bool save(const string& path) const {
+        ofstream file(path);
+        for (int t = 0; t < EVAL_TERMS; ++t) {
+            file << EVAL_TERM_NAMES[t] << " " << values[t] << "\n";
+        }
+        return bool(file);
+    }
+};
+
+// Сумма признаков с весами с точки зрения белых
+FORCE_INLINE int weightedSum(const int features[EVAL_TERMS], const int weights[EVAL_TERMS]) {
+    int score = 0;
+    UNROLL_TERMS
+    for (int t = 0; t < EVAL_TERMS; ++t) {
+        score += weights[t] * features[t];
+    }
+    return min(max(score, -EVAL_LIMIT), EVAL_LIMIT);
+}
+
+// Оценка позиции с точки зрения игрока, который делает ход
+int evaluate(const CheckersBoard& board, const EvalWeights& weights) {
+    int features[EVAL_TERMS];
+    evalFeatures(board, features);
+    int score = weightedSum(features, weights.values);
+    return board.getCurrentPlayer() == PieceColor::WHITE ? score : -score;
+}
+
+// Пакет позиций в виде структуры массивов: для оценки сразу многих позиций
+// (например, всех дочерних узлов или выборки для настройки весов)
+struct PositionBatch {
+    vector<Bitboard> white_men, white_kings, black_men, black_kings;
+    vector<int> black_to_move;
+
+    size_t size() const {
+        return white_men.size();
+    }
+
+    void clear() {
+        white_men.clear();
+        white_kings.clear();
+        black_men.clear();
+        black_kings.clear();
+        black_to_move.clear();
+    }
+
+    void add(const CheckersBoard& board) {
+        white_men.push_back(board.menOf(PieceColor::WHITE));
+        white_kings.push_back(board.kingsOf(PieceColor::WHITE));
+        black_men.push_back(board.menOf(PieceColor::BLACK));
+        black_kings.push_back(board.kingsOf(PieceColor::BLACK));
+        black_to_move.push_back(board.getCurrentPlayer() == PieceColor::BLACK ? 1 : 0);
+    }
+};
+
+// Оценка пакета (с точки зрения ходящих) в scores. Цикл без ветвлений
+// векторизуется компилятором (-O3); на x86-64 с GCC дополнительно собирается
+// вариант для AVX2, выбираемый при запуске по возможностям процессора.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+__attribute__((target_clones("avx2", "default")))
+#endif
+void evaluateBatch(const PositionBatch& batch, const EvalWeights& weights, int* __restrict scores) {
+    const Bitboard* white_men = batch.white_men.data();
+    const Bitboard* white_kings = batch.white_kings.data();
+    const Bitboard* black_men = batch.black_men.data();
+    const Bitboard* black_kings = batch.black_kings.data();
+    const int* black_to_move = batch.black_to_move.data();
+    size_t count = batch.size();
+    // Локальная копия весов: иначе запись в scores могла бы их изменить и цикл не векторизуется
+    int values[EVAL_TERMS];
+    copy(weights.values, weights.values + EVAL_TERMS, values);
+    for (size_t i = 0; i < count; ++i) {
+        int features[EVAL_TERMS];
+        evalFeatures<popCountSwar>(white_men[i], white_kings[i], black_men[i], black_kings[i], black_to_move[i], features);
+        scores[i] = weightedSum(features, values) * (1 - 2 * black_to_move[i]);
+    }
+}
+
+// ========== ЭНДШПИЛЬНЫЕ БАЗЫ ==========
+// База хранит для каждой позиции с ходом белых одно значение: ничья,
+// выигрыш или проигрыш и число полуходов до конца партии при лучшей игре.
+// Позиции с ходом черных сводятся к ходу белых поворотом доски на 180 градусов
+// (индекс клетки s переходит в 31 - s) и сменой цветов.
+// Правило ничьей 15 ходов дамками в базах не учитывается.
+const int MAX_TB_PIECES = 8;      // Наибольшее число шашек в базе
+const int TB_MAX_COUNT = 12;      // Наибольшее число шашек одного вида
+const uint8_t TB_DRAW = 0;        // Ничья
+const uint8_t TB_LOSS = 128;      // Проигрыш: TB_LOSS + полуходы (до 126)
+const uint8_t TB_UNKNOWN = 255;   // Значение еще не найдено (только при построении)
+const int TB_MAX_DISTANCE = 126;  // Наибольшая длина выигрыша в полуходах
+
+// Биномиальные коэффициенты C(n, k) для n <= 32
+struct BinomialTable {
+    uint64_t c[SQUARES + 1][SQUARES + 1];
+
+    BinomialTable() {
+        for (int n = 0; n <= SQUARES; ++n) {
+            c[n][0] = 1;
+            for (int k = 1; k <= SQUARES; ++k) {
+                c[n][k] = (n == 0) ? 0 : c[n - 1][k - 1] + c[n - 1][k];
+            }
+        }
+    }
+};
+
+const BinomialTable BINOMIAL;
+
+// Номер клетки sq среди клеток, не занятых маской taken (сжатая нумерация)
+inline int compressSquare(int sq, Bitboard taken) {
+    return sq - popCount(taken & ((Bitboard(1) << sq) - 1));
+}
+
+// n-я (с нуля) клетка, не занятая маской taken
+inline int nthFreeSquare(int n, Bitboard taken) {
+    for (int sq = 0; sq < SQUARES; ++sq) {
+        if (!((taken >> sq) & 1) && n-- == 0) {
+            return sq;
+        }
+    }
+    return -1;
+}
+
+// Колексикографический ранг набора клеток в сжатой нумерации
+inline uint64_t rankSquares(Bitboard pieces, Bitboard taken, int offset) {
+    uint64_t rank = 0;
+    int i = 0;
+    for (Bitboard b = pieces; b != 0; b &= b - 1) {
+        rank += BINOMIAL.c[compressSquare(lowestBit(b), taken) - offset][++i];
+    }
+    return rank;
+}
+
+// Обратное преобразование: k клеток по рангу; place(c) переводит сжатый номер в клетку
+template <typename Place>
+inline Bitboard unrankSquares(uint64_t rank, int k, Place place) {
+    Bitboard pieces = 0;
+    for (int i = k; i >= 1; --i) {
+        int c = i - 1;
+        while (BINOMIAL.c[c + 1][i] <= rank) {
+            ++c;
+        }
+        rank -= BINOMIAL.c[c][i];
+        pieces |= Bitboard(1) << place(c);
+    }
+    return pieces;
+}
+
+// Раздел базы: позиции с ходом белых и заданным числом шашек каждого вида.
+// Индекс совершенный - без пропусков и недопустимых позиций: белые простые
+// стоят на 28 клетках вне строки 0, черные простые - на клетках вне строки 7,
+// свободных от белых простых, дамки - на оставшихся клетках.
+struct TablebaseSlice {
+    int wm = 0, wk = 0, bm = 0, bk = 0;   // Число шашек каждого вида
+    vector<uint64_t> men_offset;          // Начало блока простых шашек для каждого ранга белых простых
+    uint64_t king_count = 0;              // Вариантов расстановки дамок
+    uint64_t size = 0;                    // Всего позиций
+
+    TablebaseSlice(int white_men, int white_kings, int black_men, int black_kings)
+        : wm(white_men), wk(white_kings), bm(black_men), bk(black_kings) {
+        uint64_t white_count = BINOMIAL.c[28][wm];
+        men_offset.resize(white_count + 1);
+        men_offset[0] = 0;
+        for (uint64_t r = 0; r < white_count; ++r) {
+            Bitboard w = unrankSquares(r, wm, [](int c) { return c + 4; });
+            int free_for_black = 28 - popCount(w & ~ROW_7);
+            men_offset[r + 1] = men_offset[r] + BINOMIAL.c[free_for_black][bm];
+        }
+        int free_for_kings = SQUARES - wm - bm;
+        king_count = BINOMIAL.c[free_for_kings][wk] * BINOMIAL.c[free_for_kings - wk][bk];
+        size = men_offset[white_count] * king_count;
+    }
+
+    uint64_t index(Bitboard w_men, Bitboard w_kings, Bitboard b_men, Bitboard b_kings) const {
+        uint64_t men_index = men_offset[rankSquares(w_men, 0, 4)] + rankSquares(b_men, w_men, 0);
+        Bitboard men = w_men | b_men;
+        uint64_t king_index = rankSquares(w_kings, men, 0) * BINOMIAL.c[SQUARES - wm - bm - wk][bk]
+                            + rankSquares(b_kings, men | w_kings, 0);
+        return men_index * king_count + king_index;
+    }
+
+    void decode(uint64_t idx, Bitboard& w_men, Bitboard& w_kings, Bitboard& b_men, Bitboard& b_kings) const {
+        uint64_t men_index = idx / king_count;
+        uint64_t king_index = idx % king_count;
+        uint64_t white_rank = uint64_t(upper_bound(men_offset.begin(), men_offset.end(), men_index) - men_offset.begin()) - 1;
+        w_men = unrankSquares(white_rank, wm, [](int c) { return c + 4; });
+        Bitboard w = w_men;
+        b_men = unrankSquares(men_index - men_offset[white_rank], bm, [w](int c) { return nthFreeSquare(c, w); });
+        Bitboard men = w_men | b_men;
+        uint64_t black_king_count = BINOMIAL.c[SQUARES - wm - bm - wk][bk];
+        w_kings = unrankSquares(king_index / black_king_count, wk, [men](int c) { return nthFreeSquare(c, men); });
+        Bitboard taken = men | w_kings;
+        b_kings = unrankSquares(king_index % black_king_count, bk, [taken](int c) { return nthFreeSquare(c, taken); });
+    }
+};
+
+// Файл, отображенный в память только для чтения
+class MappedFile {
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file, &file_size);
+        length = size_t(file_size.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        bytes = mapping != nullptr ? static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            length = size_t(info.st_size);
+            void* view = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            bytes = view != MAP_FAILED ? static_cast<const uint8_t*>(view) : nullptr;
+        }
+#endif
+        if (bytes == nullptr) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (bytes != nullptr) {
+            UnmapViewOfFile(bytes);
+        }
+        if (mapping != nullptr) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        file = INVALID_HANDLE_VALUE;
+        mapping = nullptr;
+#else
+        if (bytes != nullptr) {
+            munmap(const_cast<uint8_t*>(bytes), length);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fd = -1;
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const uint8_t* data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+};
+
+// Заголовок файла раздела базы; за ним следуют size байт значений
+struct TablebaseHeader {
+    char magic[8];          // "SHASHTB1"
+    uint8_t wm, wk, bm, bk; // Число шашек каждого вида
+    uint32_t reserved;
+    uint64_t size;          // Число позиций
+};
+
+const char TB_MAGIC[8] = { 'S', 'H', 'A', 'S', 'H', 'T', 'B', '1' };
+
+// Набор разделов эндшпильной базы: при построении значения хранятся в памяти,
+// при зондировании файлы отображаются в память и читаются без копирования
+class Tablebase {
+private:
+    struct Part {
+        TablebaseSlice slice;
+        const uint8_t* values = nullptr;  // Указывает в owned или в file
+        vector<uint8_t> owned;
+        MappedFile file;
+
+        Part(int wm, int wk, int bm, int bk)
+            : slice(wm, wk, bm, bk) {
+        }
+    };
+
+    unique_ptr<Part> parts[TB_MAX_COUNT + 1][TB_MAX_COUNT + 1][TB_MAX_COUNT + 1][TB_MAX_COUNT + 1];
+    int max_pieces = 0;     // Наибольшее число шашек среди загруженных разделов
+
+    static string fileName(const string& dir, int wm, int wk, int bm, int bk) {
+        return dir + "/tb_" + to_string(wm) + to_string(wk) + to_string(bm) + to_string(bk) + ".bin";
+    }
+
+    const Part* find(int wm, int wk, int bm, int bk) const {
+        if (wm > TB_MAX_COUNT || wk > TB_MAX_COUNT || bm > TB_MAX_COUNT || bk > TB_MAX_COUNT) {
+            return nullptr;
+        }
+        return parts[wm][wk][bm][bk].get();
+    }
+
+    // Значение позиции с ходом белых (TB_UNKNOWN, если раздела нет)
+    uint8_t lookupWhite(Bitboard w_men, Bitboard w_kings, Bitboard b_men, Bitboard b_kings) const {
+        // У ходящей стороны не осталось шашек - проигрыш
+        if ((w_men | w_kings) == 0) {
+            return TB_LOSS;
+        }
+        const Part* part = find(popCount(w_men), popCount(w_kings), popCount(b_men), popCount(b_kings));
+        if (part == nullptr || part->values == nullptr) {
+            return TB_UNKNOWN;
+        }
+        return part->values[part->slice.index(w_men, w_kings, b_men, b_kings)];
+    }
+
+    // Все составы до pieces шашек (у каждой стороны хотя бы одна). Порядок такой,
+    // чтобы взятия (меньше шашек) и превращения (меньше простых шашек) вели
+    // в разделы, стоящие раньше.
+    static vector<array<int, 4>> signatures(int pieces) {
+        vector<array<int, 4>> result;
+        for (int total = 2; total <= pieces; ++total) {
+            for (int men = 0; men <= total; ++men) {
+                for (int wm = 0; wm <= men; ++wm) {
+                    for (int wk = 0; wk <= total - men; ++wk) {
+                        int bm = men - wm;
+                        int bk = total - men - wk;
+                        if (wm + wk > 0 && bm + bk > 0 && wm <= TB_MAX_COUNT && bm <= TB_MAX_COUNT &&
+                            wk <= TB_MAX_COUNT && bk <= TB_MAX_COUNT) {
+                            result.push_back({ { wm, wk, bm, bk } });
+                        }
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    // Один раздел или пара взаимно зависимых разделов (S и S с переставленными цветами).
+    // false - длина выигрыша или проигрыша не помещается в значение позиции
+    bool solve(vector<Part*> group, uint64_t& counts_win, uint64_t& counts_loss, uint64_t& counts_draw);
+
+public:
+    int maxPieces() const {
+        return max_pieces;
+    }
+
+    // Значение позиции (TB_DRAW, выигрыш 1..126 или TB_LOSS + n) для ходящей стороны
+    bool probe(const CheckersBoard& board, uint8_t& value) const {
+        int pieces = board.countPieces(PieceColor::WHITE) + board.countPieces(PieceColor::BLACK);
+        if (pieces > max_pieces) {
+            return false;
+        }
+        if (board.getCurrentPlayer() == PieceColor::WHITE) {
+            value = lookupWhite(board.menOf(PieceColor::WHITE), board.kingsOf(PieceColor::WHITE),
+                                board.menOf(PieceColor::BLACK), board.kingsOf(PieceColor::BLACK));
+        } else {
+            value = lookupWhite(flipBoard(board.menOf(PieceColor::BLACK)), flipBoard(board.kingsOf(PieceColor::BLACK)),
+                                flipBoard(board.menOf(PieceColor::WHITE)), flipBoard(board.kingsOf(PieceColor::WHITE)));
+        }
+        return value != TB_UNKNOWN;
+    }
+
+    // Загрузка всех найденных в каталоге разделов (отображение файлов в память)
+    int load(const string& dir) {
+        int loaded = 0;
+        for (const auto& sig : signatures(MAX_TB_PIECES)) {
+            // Индекс раздела строится только для существующих файлов
+            string path = fileName(dir, sig[0], sig[1], sig[2], sig[3]);
+            if (!ifstream(path)) {
+                continue;
+            }
+            unique_ptr<Part> part(new Part(sig[0], sig[1], sig[2], sig[3]));
+            if (!part->file.open(path)) {
+                continue;
+            }
+            const TablebaseHeader* header = reinterpret_cast<const TablebaseHeader*>(part->file.data());
+            if (part->file.size() < sizeof(TablebaseHeader) || !equal(TB_MAGIC, TB_MAGIC + 8, header->magic) ||
+                header->size != part->slice.size || part->file.size() != sizeof(TablebaseHeader) + header->size) {
+                continue;
+            }
+            part->values = part->file.data() + sizeof(TablebaseHeader);
+            parts[sig[0]][sig[1]][sig[2]][sig[3]] = move(part);
+            max_pieces = max(max_pieces, sig[0] + sig[1] + sig[2] + sig[3]);
+            ++loaded;
+        }
+        return loaded;
+    }
+
+    // Построение всех разделов до pieces шашек с записью в каталог dir
+    bool generate(int pieces, const string& dir);
+};
+
+bool Tablebase::solve(vector<Part*> group, uint64_t& counts_win, uint64_t& counts_loss, uint64_t& counts_draw) {
+    // Состояние позиции при построении: число еще не решенных ходов внутри пары,
+    // наибольшая длина выигрыша противника среди решенных ходов и признаки
+    const uint8_t HAS_CAPTURE = 1;    // Есть взятие - тихих ходов из позиции нет
+    const uint8_t NOT_ALL_WIN = 2;    // Есть ход не в выигрыш противника - проигрыша быть не может
+    struct State {
+        vector<uint8_t> remaining;
+        vector<uint8_t> max_win;
+        vector<uint8_t> flags;
+    };
+    vector<State> states(group.size());
+    // Очереди позиций по длине: на нечетных уровнях - выигрыши, на четных - проигрыши.
+    // Последняя очередь не обрабатывается: она ловит длины, не помещающиеся в формат
+    const int overflow = TB_MAX_DISTANCE + 1;
+    vector<vector<pair<int, uint64_t>>> buckets(overflow + 1);
+    // Ходы белых внутри пары (тихие, без превращения) ведут в раздел-близнец
+    auto partner = [&group](int g) { return group.size() == 1 ? 0 : 1 - g; };
+    
+    CheckersBoard board(PlayerType::COMPUTER, PlayerType::COMPUTER);
+    MoveList list;
+    Undo undo;
+    
+    // Прямой проход: ходы, ведущие в другие (уже построенные) разделы, оцениваются сразу
+    for (size_t g = 0; g < group.size(); ++g) {
+        Part* part = group[g];
+        part->owned.assign(part->slice.size, TB_UNKNOWN);
+        part->values = part->owned.data();
+        State& state = states[g];
+        state.remaining.assign(part->slice.size, 0);
+        state.max_win.assign(part->slice.size, 0);
+        state.flags.assign(part->slice.size, 0);
+        for (uint64_t i = 0; i < part->slice.size; ++i) {
+            Bitboard w_men, w_kings, b_men, b_kings;
+            part->slice.decode(i, w_men, w_kings, b_men, b_kings);
+            board.setPieces(w_men, w_kings, b_men, b_kings, PieceColor::WHITE);
+            board.generateMoves(list);
+            if (list.empty()) {
+                buckets[0].push_back(make_pair(int(g), i));
+                continue;
+            }
+            int win_at = overflow + 1;
+            for (const Move& move : list) {
+                if (!move.isCapture() && !move.promotion) {
+                    ++state.remaining[i];
+                    continue;
+                }
+                board.doMove(move, undo);
+                // Ход черных: смотрим повернутую позицию с ходом белых
+                uint8_t child = lookupWhite(flipBoard(board.menOf(PieceColor::BLACK)), flipBoard(board.kingsOf(PieceColor::BLACK)),
+                                            flipBoard(board.menOf(PieceColor::WHITE)), flipBoard(board.kingsOf(PieceColor::WHITE)));
+                board.undoMove(undo);
+                if (child >= TB_LOSS && child != TB_UNKNOWN) {
+                    win_at = min(win_at, child - TB_LOSS + 1);
+                    state.flags[i] |= NOT_ALL_WIN;
+                } else if (child != TB_DRAW && child != TB_UNKNOWN) {
+                    state.max_win[i] = max(state.max_win[i], child);
+                } else {
+                    state.flags[i] |= NOT_ALL_WIN;
+                }
+            }
+            if (list[0].isCapture()) {
+                state.flags[i] |= HAS_CAPTURE;
+            }
+            if (win_at <= overflow) {
+                buckets[win_at].push_back(make_pair(int(g), i));
+            } else if (state.remaining[i] == 0 && !(state.flags[i] & NOT_ALL_WIN)) {
+                buckets[state.max_win[i] + 1].push_back(make_pair(int(g), i));
+            }
+        }
+    }
+    
+    // Обратный проход по уровням длины: решенная позиция уточняет своих
+    // предшественников - позиции, из которых в нее ведет тихий ход
+    for (int d = 0; d <= TB_MAX_DISTANCE; ++d) {
+        for (size_t k = 0; k < buckets[d].size(); ++k) {
+            int g = buckets[d][k].first;
+            uint64_t i = buckets[d][k].second;
+            uint8_t* values = group[g]->owned.data();
+            if (values[i] != TB_UNKNOWN) {
+                continue;
+            }
+            values[i] = (d % 2 == 1) ? uint8_t(d) : uint8_t(TB_LOSS + d);
+            
+            // Исходная ориентация: только что ходили белые (здесь это черные, повернутые обратно)
+            Bitboard w_men, w_kings, b_men, b_kings;
+            group[g]->slice.decode(i, w_men, w_kings, b_men, b_kings);
+            Bitboard mover_men = flipBoard(b_men);
+            Bitboard mover_kings = flipBoard(b_kings);
+            Bitboard other_men = flipBoard(w_men);
+            Bitboard other_kings = flipBoard(w_kings);
+            Bitboard empty = ~(mover_men | mover_kings | other_men | other_kings);
+            int p = partner(g);
+            const TablebaseSlice& pred_slice = group[p]->slice;
+            State& pred_state = states[p];
+            const uint8_t* pred_values = group[p]->owned.data();
+            
+            auto visit = [&](Bitboard men, Bitboard kings) {
+                uint64_t j = pred_slice.index(men, kings, other_men, other_kings);
+                if (pred_values[j] != TB_UNKNOWN || (pred_state.flags[j] & HAS_CAPTURE)) {
+                    return;
+                }
+                if (d % 2 == 0) {
+                    // Есть ход в проигрыш противника - выигрыш на уровень дальше
+                    buckets[d + 1].push_back(make_pair(p, j));
+                } else {
+                    pred_state.max_win[j] = max(pred_state.max_win[j], uint8_t(d));
+                    if (--pred_state.remaining[j] == 0 && !(pred_state.flags[j] & NOT_ALL_WIN)) {
+                        buckets[pred_state.max_win[j] + 1].push_back(make_pair(p, j));
+                    }
+                }
+            };
+            // Простая шашка пришла на одну клетку снизу
+            for (Bitboard b = mover_men; b != 0; b &= b - 1) {
+                Bitboard bit = b & (0 - b);
+                Bitboard sources = (shiftDownLeft(bit) | shiftDownRight(bit)) & empty;
+                for (; sources != 0; sources &= sources - 1) {
+                    visit((mover_men ^ bit) | (sources & (0 - sources)), mover_kings);
+                }
+            }
+            // Дамка пришла по диагонали с любого расстояния
+            for (Bitboard b = mover_kings; b != 0; b &= b - 1) {
+                Bitboard bit = b & (0 - b);
+                for (const auto& dir : DIRECTIONS) {
+                    for (Bitboard src = shiftDiagonal(bit, dir[0], dir[1]); src & empty; src = shiftDiagonal(src, dir[0], dir[1])) {
+                        visit(mover_men, (mover_kings ^ bit) | src);
+                    }
+                }
+            }
+        }
+        vector<pair<int, uint64_t>>().swap(buckets[d]);
+    }
+    
+    // Нерешенная позиция в последней очереди - выигрыш длиннее TB_MAX_DISTANCE:
+    // записать его ничьей нельзя
+    for (const auto& entry : buckets[overflow]) {
+        if (group[entry.first]->owned[entry.second] == TB_UNKNOWN) {
+            return false;
+        }
+    }
+    
+    // Все, что не решено, - ничья
+    for (Part* part : group) {
+        for (uint8_t& value : part->owned) {
+            if (value == TB_UNKNOWN) {
+                value = TB_DRAW;
+            }
+            counts_win += (value != TB_DRAW && value < TB_LOSS) ? 1 : 0;
+            counts_loss += value >= TB_LOSS ? 1 : 0;
+            counts_draw += value == TB_DRAW ? 1 : 0;
+        }
+    }
+    return true;
+}
+
+bool Tablebase::generate(int pieces, const string& dir) {
+    typedef chrono::steady_clock Clock;
+    pieces = min(pieces, MAX_TB_PIECES);
+    for (const auto& sig : signatures(pieces)) {
+        if (find(sig[0], sig[1], sig[2], sig[3]) != nullptr) {
+            continue;  // Уже построен в паре с раздел-близнецом
+        }
+        Clock::time_point start = Clock::now();
+        vector<Part*> group;
+        parts[sig[0]][sig[1]][sig[2]][sig[3]].reset(new Part(sig[0], sig[1], sig[2], sig[3]));
+        group.push_back(parts[sig[0]][sig[1]][sig[2]][sig[3]].get());
+        if (sig[0] != sig[2] || sig[1] != sig[3]) {
+            parts[sig[2]][sig[3]][sig[0]][sig[1]].reset(new Part(sig[2], sig[3], sig[0], sig[1]));
+            group.push_back(parts[sig[2]][sig[3]][sig[0]][sig[1]].get());
+        }
+        max_pieces = max(max_pieces, sig[0] + sig[1] + sig[2] + sig[3]);
+        uint64_t wins = 0, losses = 0, draws = 0;
+        if (!solve(group, wins, losses, draws)) {
+            cout << "tb_" << sig[0] << sig[1] << sig[2] << sig[3] << ": выигрыш длиннее " << TB_MAX_DISTANCE
+                 << " полуходов не помещается в формат базы, построение прервано" << endl;
+            return false;
+        }
+        
+        for (Part* part : group) {
+            const TablebaseSlice& slice = part->slice;
+            ofstream out(fileName(dir, slice.wm, slice.wk, slice.bm, slice.bk), ios::binary);
+            TablebaseHeader header = {};
+            copy(TB_MAGIC, TB_MAGIC + 8, header.magic);
+            header.wm = uint8_t(slice.wm);
+            header.wk = uint8_t(slice.wk);
+            header.bm = uint8_t(slice.bm);
+            header.bk = uint8_t(slice.bk);
+            header.size = slice.size;
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char*>(part->owned.data()), streamsize(part->owned.size()));
+            if (!out) {
+                cout << "Не удалось записать раздел базы в каталог " << dir << endl;
+                return false;
+            }
+            cout << "tb_" << slice.wm << slice.wk << slice.bm << slice.bk << ": " << slice.size << " позиций";
+            if (part == group.back()) {
+                cout << " (вместе: выигрышей " << wins << ", проигрышей " << losses << ", ничьих " << draws << ", "
+                     << chrono::duration<double>(Clock::now() - start).count() << " с)";
+            }
+            cout << endl;
+        }
+    }
+    return true;
+}
+
+// Режим построения базы: Shashki tablebase [--pieces N] [--path DIR]
+int runTablebaseMode(int argc, char* argv[]) {
+    int pieces = 4;
+    string dir = ".";
+    for (int i = 0; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--pieces") {
+            pieces = atoi(argv[i + 1]);
+        } else if (arg == "--path") {
+            dir = argv[i + 1];
+        } else {
+            cout << "Неизвестный параметр базы: " << arg << endl;
+            return 1;
+        }
+    }
+    Tablebase tablebase;
+    return tablebase.generate(pieces, dir) ? 0 : 1;
+}
+
+// ========== ДЕБЮТНАЯ КНИГА ==========
+// Книга строится из записей партий (PDN): для каждой позиции первых
+// полуходов накапливается статистика ходов. Файл - отсортированный массив
+// записей фиксированного размера, поиск - двоичный по отображенному в память файлу.
+
+// Запись партии: стартовая позиция, ходы и победитель (NONE - ничья)
+struct GameRecord {
+    string fen = START_FEN;
+    vector<Move> moves;
+    PieceColor winner = PieceColor::NONE;
+};
+
+// Запись хода move из позиции board в нотации PDN. Взятие, которое по начальной и
+// конечной клеткам не отличить от другого, записывается полным путем "a x b x ... x c".
+string moveToText(const CheckersBoard& board, const Move& move) {
+    MoveList list, same;
+    board.generateMoves(list);
+    board.movesBetween(list, move.from, move.to, same);
+    vector<int> path;
+    if (same.size() < 2 || !board.capturePath(move, {}, path)) {
+        return moveToString(move);
+    }
+    string text = to_string(move.from + 1);
+    for (int square : path) {
+        text += "x" + to_string(square + 1);
+    }
+    return text;
+}
+
+// Запись партии в формате PDN (русские шашки, GameType 25)
+void writePdnGame(ostream& out, const GameRecord& game, const string& event) {
+    const char* result = game.winner == PieceColor::WHITE ? "2-0" : game.winner == PieceColor::BLACK ? "0-2" : "1-1";
+    out << "[Event \"" << event << "\"]\n"
+        << "[GameType \"25\"]\n"
+        << "[FEN \"" << game.fen << "\"]\n"
+        << "[Result \"" << result << "\"]\n";
+    bool white_first = game.fen.empty() || game.fen[0] != 'B';
+    CheckersBoard board(PlayerType::COMPUTER, PlayerType::COMPUTER);
+    board.setPosition(game.fen);
+    for (size_t i = 0; i < game.moves.size(); ++i) {
+        size_t ply = i + (white_first ? 0 : 1);
+        if (ply % 2 == 0) {
+            out << (ply / 2 + 1) << ". ";
+        } else if (i == 0) {
+            out << "1... ";
+        }
+        out << moveToText(board, game.moves[i]) << ((i + 1) % 16 == 0 ? "\n" : " ");
+        board.applyMove(game.moves[i]);
+    }
+    out << result << "\n\n";
+}
+
+// Разбор результата PDN; false, если token - не результат
+bool parsePdnResult(const string& token, PieceColor& winner) {
+    if (token == "2-0" || token == "1-0") {
+        winner = PieceColor::WHITE;
+    } else if (token == "0-2" || token == "0-1") {
+        winner = PieceColor::BLACK;
+    } else if (token == "1-1" || token == "1/2-1/2" || token == "*") {
+        winner = PieceColor::NONE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Поиск хода в записи PDN ("a-b", "axb" или полный путь "axbxc...") среди допустимых
+// ходов list позиции board. Промежуточные клетки пути выбирают одно из взятий
+// с общими начальной и конечной клетками. nullptr, если такого хода нет или
+// запись подходит к разным взятиям (тогда ambiguous, если задан, равен true).
+const Move* parseMoveText(const CheckersBoard& board, const string& text, const MoveList& list,
+                          bool* ambiguous = nullptr) {
+    if (ambiguous != nullptr) {
+        *ambiguous = false;
+    }
+    vector<int> squares;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find_first_of("-x:", start);
+        string number = text.substr(start, end == string::npos ? string::npos : end - start);
+        if (number.empty() || number.find_first_not_of("0123456789") != string::npos) {
+            return nullptr;
+        }
+        squares.push_back(atoi(number.c_str()) - 1);
+        if (end == string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    if (squares.size() < 2) {
+        return nullptr;
+    }
+    
+    MoveList candidates;
+    board.movesBetween(list, squares.front(), squares.back(), candidates);
+    // Единственный ход с этими клетками подходит к краткой записи; иначе запись
+    // читается как полный путь - клетки остановки после каждого взятия
+    vector<int> wanted(squares.begin() + 1, squares.end());
+    const Move* found = nullptr;
+    int matches = 0;
+    for (const Move& move : candidates) {
+        vector<int> path;
+        if ((squares.size() == 2 && candidates.size() == 1) || board.capturePath(move, wanted, path)) {
+            found = &move;
+            ++matches;
+        }
+    }
+    if (matches != 1) {
+        if (ambiguous != nullptr) {
+            *ambiguous = matches > 1 || (candidates.size() > 1 && squares.size() == 2);
+        }
+        return nullptr;
+    }
+    for (const Move& move : list) {
+        if (move.from == found->from && move.to == found->to && move.captured == found->captured) {
+            return &move;
+        }
+    }
+    return nullptr;
+}
+
+// Чтение всех партий из PDN; партия обрывается на первом непонятом ходе.
+int readPdnGames(istream& in, vector<GameRecord>& games) {
+    int skipped = 0;
+    CheckersBoard board(PlayerType::COMPUTER, PlayerType::COMPUTER);
+    MoveList list;
+    bool in_game = false;
+    bool broken = false;
+    
+    auto startGame = [&]() {
+        games.push_back(GameRecord());
+        board.setPosition(START_FEN);
+        in_game = true;
+        broken = false;
+    };
+    
+    char c;
+    while (in.get(c)) {
+        if (isspace(static_cast<unsigned char>(c))) {
+            continue;
+        }
+        // Тег [Name "Value"]: новый тег после ходов начинает следующую партию
+        if (c == '[') {
+            string tag;
+            getline(in, tag, ']');
+            if (!in_game || !games.back().moves.empty()) {
+                startGame();
+            }
+            size_t quote = tag.find('"');
+            string name = tag.substr(0, tag.find_first_of(" \t"));
+            string value = quote != string::npos ? tag.substr(quote + 1, tag.rfind('"') - quote - 1) : "";
+            if (name == "FEN") {
+                if (board.setPosition(value)) {
+                    games.back().fen = value;
+                } else {
+                    broken = true;
+                }
+            } else if (name == "Result") {
+                parsePdnResult(value, games.back().winner);
+            }
+            continue;
+        }
+        // Комментарии и варианты пропускаются
+        if (c == '{') {
+            in.ignore(numeric_limits<streamsize>::max(), '}');
+            continue;
+        }
+        if (c == '(') {
+            for (int depth = 1; depth > 0 && in.get(c); ) {
+                depth += (c == '(') ? 1 : (c == ')') ? -1 : 0;
+            }
+            continue;
+        }
+        string token(1, c);
+        while (in.get(c) && !isspace(static_cast<unsigned char>(c)) && c != '{' && c != '[' && c != '(') {
+            token += c;
+        }
+        if (!isspace(static_cast<unsigned char>(c))) {
+            in.unget();
+        }
+        if (!in_game) {
+            startGame();
+        }
+        PieceColor winner;
+        if (parsePdnResult(token, winner)) {
+            games.back().winner = winner;
+            in_game = false;
+            continue;
+        }
+        // Номер хода "12." или "12..." (возможно, слитно с ходом)
+        size_t dot = token.find_last_of('.');
+        if (dot != string::npos) {
+            token = token.substr(dot + 1);
+        }
+        if (token.empty() || broken) {
+            continue;
+        }
+        board.generateMoves(list);
+        const Move* found = parseMoveText(board, token, list);
+        if (found == nullptr) {
+            broken = true;
+            ++skipped;
+            continue;
+        }
+        games.back().moves.push_back(*found);
+        board.applyMove(*found);
+    }
+    return skipped;
+}
+
+// Запись книги: ключ позиции, ход и итоги партий с точки зрения сделавшего ход.
+// Взятые шашки входят в ход: взятия с одинаковыми клетками не сливаются
+struct BookEntry {
+    uint64_t key;
+    Bitboard captured;
+    uint8_t from, to;
+    uint16_t wins, draws, losses;
+    uint32_t reserved;
+
+    bool operator<(const BookEntry& other) const {
+        return key != other.key ? key < other.key : from != other.from ? from < other.from :
+               to != other.to ? to < other.to : captured < other.captured;
+    }
+
+    bool sameMove(const BookEntry& other) const {
+        return key == other.key && from == other.from && to == other.to && captured == other.captured;
+    }
+};
+
+// Заголовок файла книги; за ним следуют count записей
+struct BookHeader {
+    char magic[8];          // "SHASHBK2"
+    uint64_t count;         // Число записей
+};
+
+const char BOOK_MAGIC[8] = { 'S', 'H', 'A', 'S', 'H', 'B', 'K', '2' };
+
+// Дебютная книга, отображенная в память
+class OpeningBook {
+private:
+    MappedFile file;
+    const BookEntry* entries = nullptr;
+    size_t count = 0;
+
+public:
+    bool load(const string& path) {
+        entries = nullptr;
+        count = 0;
+        if (!file.open(path) || file.size() < sizeof(BookHeader)) {
+            return false;
+        }
+        const BookHeader* header = reinterpret_cast<const BookHeader*>(file.data());
+        if (!equal(BOOK_MAGIC, BOOK_MAGIC + 8, header->magic) ||
+            file.size() != sizeof(BookHeader) + header->count * sizeof(BookEntry)) {
+            file.close();
+            return false;
+        }
+        entries = reinterpret_cast<const BookEntry*>(file.data() + sizeof(BookHeader));
+        count = size_t(header->count);
+        return true;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Выбор хода из книги. Вес хода - набранные им очки (победа 2, ничья 1),
+    // выбор детерминирован: зависит только от позиции и seed.
+    bool probe(const CheckersBoard& board, uint64_t seed, Move& move) const {
+        BookEntry key = {};
+        key.key = board.getHash();
+        const BookEntry* first = lower_bound(entries, entries + count, key);
+        const BookEntry* last = first;
+        while (last != entries + count && last->key == key.key) {
+            ++last;
+        }
+        if (first == last) {
+            return false;
+        }
+        MoveList list;
+        board.generateMoves(list);
+        const Move* candidates[MAX_MOVES];
+        uint64_t weights[MAX_MOVES];
+        int candidate_count = 0;
+        uint64_t total = 0;
+        for (const BookEntry* entry = first; entry != last; ++entry) {
+            uint64_t weight = 2 * uint64_t(entry->wins) + entry->draws;
+            // Ход должен быть допустим: защита от совпадения ключей
+            for (const Move& legal : list) {
+                if (weight != 0 && legal.from == entry->from && legal.to == entry->to && legal.captured == entry->captured &&
+                    candidate_count < MAX_MOVES) {
+                    candidates[candidate_count] = &legal;
+                    weights[candidate_count++] = weight;
+                    total += weight;
+                    break;
+                }
+            }
+        }
+        if (total == 0) {
+            return false;
+        }
+        uint64_t state = key.key ^ seed;
+        uint64_t pick = splitMix64(state) % total;
+        for (int i = 0; i < candidate_count; ++i) {
+            if (pick < weights[i]) {
+                move = *candidates[i];
+                return true;
+            }
+            pick -= weights[i];
+        }
+        return false;
+    }
+};
+
+// Построение книги: позиции первых plies полуходов каждой партии; ходы,
+// сыгранные реже min_games раз, отбрасываются
+bool buildBook(const vector<GameRecord>& games, int plies, int min_games, const string& path) {
+    vector<BookEntry> raw;
+    CheckersBoard board(PlayerType::COMPUTER, PlayerType::COMPUTER);
+    for (const GameRecord& game : games) {
+        board.setPosition(game.fen);
+        for (size_t i = 0; i < game.moves.size() && int(i) < plies; ++i) {
+            BookEntry entry = {};
+            entry.key = board.getHash();
+            entry.from = game.moves[i].from;
+            entry.to = game.moves[i].to;
+            entry.captured = game.moves[i].captured;
+            if (game.winner == PieceColor::NONE) {
+                entry.draws = 1;
+            } else if (game.winner == board.getCurrentPlayer()) {
+                entry.wins = 1;
+            } else {
+                entry.losses = 1;
+            }
+            raw.push_back(entry);
+            board.applyMove(game.moves[i]);
+        }
+    }
+    
+    // Сортировка и слияние одинаковых ходов из одной позиции (счетчики с насыщением)
+    sort(raw.begin(), raw.end());
+    vector<BookEntry> merged;
+    for (const BookEntry& entry : raw) {
+        if (!merged.empty() && merged.back().sameMove(entry)) {
+            BookEntry& target = merged.back();
+            target.wins = uint16_t(min(int(target.wins) + entry.wins, 0xFFFF));
+            target.draws = uint16_t(min(int(target.draws) + entry.draws, 0xFFFF));
+            target.losses = uint16_t(min(int(target.losses) + entry.losses, 0xFFFF));
+        } else {
+            merged.push_back(entry);
+        }
+    }
+    merged.erase(remove_if(merged.begin(), merged.end(), [min_games](const BookEntry& entry) {
+        return int(entry.wins) + entry.draws + entry.losses < min_games;
+    }), merged.end());
+    
+    ofstream out(path, ios::binary);
+    BookHeader header = {};
+    copy(BOOK_MAGIC, BOOK_MAGIC + 8, header.magic);
+    header.count = merged.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(merged.data()), streamsize(merged.size() * sizeof(BookEntry)));
+    if (!out) {
+        cout << "Не удалось записать книгу: " << path << endl;
+        return false;
+    }
+    uint64_t positions = 0;
+    for (size_t i = 0; i < merged.size(); ++i) {
+        positions += (i == 0 || merged[i].key != merged[i - 1].key) ? 1 : 0;
+    }
+    cout << "Партий: " << games.size() << ", позиций: " << positions << ", записей: " << merged.size() << endl;
+    return true;
+}
+
+// Режим построения книги: Shashki book --pdn FILE [--pdn FILE ...] [--out FILE]
+//                                      [--plies N] [--min-games N]
+int runBookMode(int argc, char* argv[]) {
+    vector<string> inputs;
+    string path = "book.bin";
+    int plies = 16;
+    int min_games = 1;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--pdn") {
+            inputs.push_back(argv[i + 1]);
+        } else if (arg == "--out") {
+            path = argv[i + 1];
+        } else if (arg == "--plies") {
+            plies = atoi(argv[i + 1]);
+        } else if (arg == "--min-games") {
+            min_games = atoi(argv[i + 1]);
+        } else {
+            cout << "Неизвестный параметр книги: " << arg << endl;
+            return 1;
+        }
+    }
+    if (inputs.empty()) {
+        cout << "Не заданы файлы партий (--pdn FILE)" << endl;
+        return 1;
+    }
+    vector<GameRecord> games;
+    for (const string& input : inputs) {
+        ifstream file(input);
+        if (!file) {
+            cout << "Не удалось открыть файл: " << input << endl;
+            return 1;
+        }
+        int skipped = readPdnGames(file, games);
+        if (skipped != 0) {
+            cout << input << ": партий с непонятыми ходами: " << skipped << endl;
+        }
+    }
+    return buildBook(games, plies, min_games, path) ? 0 : 1;
+}
+
+// ========== ТАБЛИЦА ТРАНСПОЗИЦИЙ ==========
+const size_t DEFAULT_HASH_MB = 64;  // Размер таблицы по умолчанию
+
+// Тип оценки, сохраненной в таблице
+enum class Bound : uint8_t { NONE, UPPER, LOWER, EXACT };
+
+// Распакованная запись таблицы
+struct TTEntry {
+    int score = 0;               // Оценка (выигрыш - относительно текущего узла)
+    int depth = 0;               // Глубина, с которой получена оценка
+    Bound bound = Bound::NONE;   // Тип оценки
+    int move_from = -1;          // Лучший ход (-1, если его нет)
+    int move_to = -1;
+};
+
+// Общая для всех потоков таблица транспозиций фиксированного размера без блокировок.
+// Запись - два 64-битных слова: данные и ключ, объединенный с данными через XOR.
+// Запись, разорванная одновременной записью из другого потока, не проходит
+// проверку ключа и считается отсутствующей.
+class TranspositionTable {
+private:
+    static const int BUCKET_SIZE = 4;  // Записей в корзине (одна строка кэша)
+
+    struct Slot {
+        atomic<uint64_t> key_xor_data;
+        atomic<uint64_t> data;
+    };
+
+    struct alignas(64) Bucket {
+        Slot slots[BUCKET_SIZE];
+    };
+
+    unique_ptr<Bucket[]> buckets;
+    size_t bucket_count = 0;      // Степень двойки
+    uint8_t generation = 0;       // Номер поиска для вытеснения старых записей
+
+    // Упаковка: оценка (16 бит), глубина (8), тип (2), ход (1 + 5 + 5), поколение (8)
+    static uint64_t pack(int score, int depth, Bound bound, int from, int to, uint8_t age) {
+        uint64_t has_move = from >= 0 ? 1 : 0;
+        return uint64_t(uint16_t(score + 32768))
+             | (uint64_t(uint8_t(depth)) << 16)
+             | (uint64_t(bound) << 24)
+             | (has_move << 26)
+             | (uint64_t(from & 31) << 27)
+             | (uint64_t(to & 31) << 32)
+             | (uint64_t(age) << 37);
+    }
+
+    static TTEntry unpack(uint64_t data) {
+        TTEntry entry;
+        entry.score = int(data & 0xFFFF) - 32768;
+        entry.depth = int((data >> 16) & 0xFF);
+        entry.bound = Bound((data >> 24) & 3);
+        if ((data >> 26) & 1) {
+            entry.move_from = int((data >> 27) & 31);
+            entry.move_to = int((data >> 32) & 31);
+        }
+        return entry;
+    }
+
+    static uint8_t ageOf(uint64_t data) {
+        return uint8_t(data >> 37);
+    }
+
+    Bucket& bucketFor(uint64_t key) const {
+        return buckets[key & (bucket_count - 1)];
+    }
+
+public:
+    explicit TranspositionTable(size_t mb = DEFAULT_HASH_MB) {
+        resize(mb);
+    }
+
+    // Установка размера в мегабайтах (округляется вниз до степени двойки корзин)
+    void resize(size_t mb) {
+        size_t count = 1;
+        while (count * 2 * sizeof(Bucket) <= max<size_t>(mb, 1) * 1024 * 1024) {
+            count *= 2;
+        }
+        buckets.reset(new Bucket[count]);
+        bucket_count = count;
+        clear();
+    }
+
+    void clear() {
+        for (size_t i = 0; i < bucket_count; ++i) {
+            for (Slot& slot : buckets[i].slots) {
+                slot.key_xor_data.store(0, memory_order_relaxed);
+                slot.data.store(0, memory_order_relaxed);
+            }
+        }
+        generation = 0;
+    }
+
+    size_t sizeMb() const {
+        return bucket_count * sizeof(Bucket) / (1024 * 1024);
+    }
+
+    // Начало нового поиска: записи прошлых поисков вытесняются в первую очередь
+    void newSearch() {
+        ++generation;
+    }
+
+    bool probe(uint64_t key, TTEntry& entry) const {
+        Bucket& bucket = bucketFor(key);
+        for (Slot& slot : bucket.slots) {
+            uint64_t data = slot.data.load(memory_order_relaxed);
+            uint64_t check = slot.key_xor_data.load(memory_order_relaxed);
+            if ((check ^ data) == key && data != 0) {
+                entry = unpack(data);
+                return entry.bound != Bound::NONE;
+            }
+        }
+        return false;
+    }
+
+    void store(uint64_t key, int score, int depth, Bound bound, int from, int to) {
+        Bucket& bucket = bucketFor(key);
+        Slot* target = &bucket.slots[0];
+        int worst = INT32_MAX;
+        for (Slot& slot : bucket.slots) {
+            uint64_t data = slot.data.load(memory_order_relaxed);
+            uint64_t check = slot.key_xor_data.load(memory_order_relaxed);
+            // Та же позиция - перезаписываем, сохраняя прежний ход, если нового нет
+            if ((check ^ data) == key) {
+                TTEntry old = unpack(data);
+                if (from < 0) {
+                    from = old.move_from;
+                    to = old.move_to;
+                }
+                target = &slot;
+                break;
+            }
+            // Иначе вытесняем самую мелкую запись, прежде всего из старых поисков
+            int value = int((data >> 16) & 0xFF) + (ageOf(data) == generation ? 256 : 0);
+            if (value < worst) {
+                worst = value;
+                target = &slot;
+            }
+        }
+        uint64_t data = pack(score, depth, bound, from, to, generation);
+        target->data.store(data, memory_order_relaxed);
+        target->key_xor_data.store(key ^ data, memory_order_relaxed);
+    }
+
+    // Заполненность в промилле по первым корзинам (записи текущего поиска)
+    int hashfull() const {
+        size_t sample = min<size_t>(bucket_count, 250);
+        int used = 0;
+        for (size_t i = 0; i < sample; ++i) {
+            for (const Slot& slot : buckets[i].slots) {
+                uint64_t data = slot.data.load(memory_order_relaxed);
+                if (data != 0 && ageOf(data) == generation) {
+                    ++used;
+                }
+            }
+        }
+        return int(used * 1000 / (sample * BUCKET_SIZE));
+    }
+};
+
+// ========== ПРОФИЛИРОВАНИЕ ПОИСКА ==========
+// Счетчики узлов и отсечений и таймеры фаз поиска. Включаются с SHASHKI_PROFILE=1
+// (по умолчанию - в сборках без NDEBUG); при SHASHKI_PROFILE=0 макросы PROFILE_*
+// пусты и в поиск не попадает ни одной лишней инструкции.
+#ifndef SHASHKI_PROFILE
+#ifdef NDEBUG
+#define SHASHKI_PROFILE 0
+#else
+#define SHASHKI_PROFILE 1
+#endif
+#endif
+
+// Фазы поиска, время которых измеряется отдельно
+enum ProfilePhase {
+    PHASE_MOVEGEN,          // Генерация ходов
+    PHASE_MAKE_UNMAKE,      // doMove/undoMove
+    PHASE_EVAL,             // Оценка позиции
+    PHASE_TT,               // Таблица транспозиций
+    PHASE_TABLEBASE,        // Эндшпильные базы
+    PROFILE_PHASES
+};
+
+const char* const PROFILE_PHASE_NAMES[PROFILE_PHASES] = { "movegen", "make_unmake", "eval", "tt", "tablebase" };
+
+// Метка времени для таймеров: счетчик тактов процессора на x86, иначе steady_clock.
+// В секунды переводится по частоте, измеренной за время поиска.
+inline uint64_t profileTicks() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return uint64_t(chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Профиль поиска (одного потока, одного хода или целой партии)
+struct SearchProfile {
+    uint64_t qnodes = 0;                // Узлы досчета взятий (глубина <= 0)
+    uint64_t expanded = 0;              // Узлы, в которых перебирались ходы
+    uint64_t children = 0;              // Просмотрено ходов в этих узлах
+    uint64_t cutoffs = 0;               // Отсечения по beta
+    uint64_t first_move_cutoffs = 0;    // Отсечения на первом же ходе
+    uint64_t prev_iteration_nodes = 0;  // Узлы двух последних итераций главного потока
+    uint64_t last_iteration_nodes = 0;
+    uint64_t ticks[PROFILE_PHASES] = {};  // Время фаз (сумма по потокам)
+    uint64_t search_ticks = 0;          // Все время потоков в поиске
+    double ticks_per_second = 0;        // Частота меток времени
+
+    void add(const SearchProfile& other) {
+        qnodes += other.qnodes;
+        expanded += other.expanded;
+        children += other.children;
+        cutoffs += other.cutoffs;
+        first_move_cutoffs += other.first_move_cutoffs;
+        prev_iteration_nodes += other.prev_iteration_nodes;
+        last_iteration_nodes += other.last_iteration_nodes;
+        for (int i = 0; i < PROFILE_PHASES; ++i) {
+            ticks[i] += other.ticks[i];
+        }
+        search_ticks += other.search_ticks;
+        if (ticks_per_second == 0) {
+            ticks_per_second = other.ticks_per_second;
+        }
+    }
+
+    // Средняя ветвистость: просмотрено ходов на узел с перебором
+    double branchingFactor() const {
+        return expanded != 0 ? double(children) / double(expanded) : 0.0;
+    }
+
+    // Эффективная ветвистость: рост числа узлов от итерации к итерации
+    double effectiveBranchingFactor() const {
+        return prev_iteration_nodes != 0 ? double(last_iteration_nodes) / double(prev_iteration_nodes) : 0.0;
+    }
+
+    double cutoffRate() const {
+        return expanded != 0 ? double(cutoffs) / double(expanded) : 0.0;
+    }
+
+    // Доля отсечений на первом ходе - качество упорядочивания ходов
+    double firstMoveCutoffRate() const {
+        return cutoffs != 0 ? double(first_move_cutoffs) / double(cutoffs) : 0.0;
+    }
+
+    double seconds(uint64_t phase_ticks) const {
+        return ticks_per_second > 0 ? double(phase_ticks) / ticks_per_second : 0.0;
+    }
+};
+
+// Добавляет к счетчику время от создания до уничтожения таймера
+class ProfileTimer {
+private:
+    uint64_t& counter;
+    uint64_t start;
+
+public:
+    explicit ProfileTimer(uint64_t& phase_ticks) : counter(phase_ticks), start(profileTicks()) {
+    }
+
+    ~ProfileTimer() {
+        counter += profileTicks() - start;
+    }
+};
+
+#if SHASHKI_PROFILE
+#define PROFILE_COUNT(counter) (++(counter))
+#define PROFILE_TIMED(profile, phase, ...) do { ProfileTimer profile_timer((profile).ticks[phase]); __VA_ARGS__; } while (0)
+#else
+#define PROFILE_COUNT(counter) ((void)0)
+#define PROFILE_TIMED(profile, phase, ...) do { __VA_ARGS__; } while (0)
+#endif
+
+// ========== ПОИСК ==========
+const int WIN_SCORE = 30000;  // Оценка выигрыша (уменьшается на длину пути до него)
+const int INF_SCORE = 32000;
+const int MAX_PLY = 128;      // Предельная глубина пути от корня
+// Оценки не дальше WIN_BAND от WIN_SCORE - выигрыш с известной длиной (с учетом баз)
+const int WIN_BAND = MAX_PLY + TB_MAX_DISTANCE;
+
+// Оценки выигрыша хранятся относительно узла, а не корня
+inline int scoreToTT(int score, int ply) {
+    return score >= WIN_SCORE - WIN_BAND ? score + ply : score <= -WIN_SCORE + WIN_BAND ? score - ply : score;
+}
+
+inline int scoreFromTT(int score, int ply) {
+    return score >= WIN_SCORE - WIN_BAND ? score - ply : score <= -WIN_SCORE + WIN_BAND ? score + ply : score;
+}
+
+// Ограничения поиска (0 - без ограничения)
+struct Limits {
+    int max_depth = 64;         // Глубина итеративного углубления
+    uint64_t max_nodes = 0;     // Число узлов (всех потоков)
+    int time_ms = 0;            // Время на ход в миллисекундах
+};
+
+// Результат поиска
+struct SearchResult {
+    Move best_move;             // Лучший ход
+    bool has_move = false;      // false, если ходов нет
+    bool from_book = false;     // Ход взят из дебютной книги (без поиска)
+    int score = 0;              // Оценка с точки зрения ходящего
+    int depth = 0;              // Последняя полностью просмотренная глубина
+    int threads = 1;            // Число потоков поиска
+    uint64_t nodes = 0;         // Просмотрено узлов (всеми потоками)
+    uint64_t tt_probes = 0;     // Обращений к таблице транспозиций
+    uint64_t tt_hits = 0;       // Найдено записей в таблице
+    uint64_t tb_hits = 0;       // Позиций, найденных в эндшпильных базах
+    int hashfull = 0;           // Заполненность таблицы в промилле
+    double seconds = 0;         // Затраченное время
+    SearchProfile profile;      // Счетчики и время фаз (при SHASHKI_PROFILE)
+
+    double ttHitRate() const {
+        return tt_probes != 0 ? double(tt_hits) / double(tt_probes) : 0.0;
+    }
+
+    // Узлов в секунду
+    uint64_t nps() const {
+        return seconds > 0 ? uint64_t(double(nodes) / seconds) : nodes;
+    }
+};
+
+// Общее для всех потоков одного поиска состояние
+struct SharedSearchState {
+    typedef chrono::steady_clock Clock;
+
+    TranspositionTable* tt = nullptr;   // Общая таблица транспозиций
+    const Tablebase* tablebase = nullptr;  // Эндшпильные базы (если загружены)
+    const EvalWeights* weights = nullptr;  // Веса оценки позиции
+    Limits limits;                      // Ограничения поиска
+    Clock::time_point start;            // Время начала поиска
+    bool single_thread = true;          // Однопоточный режим (точный учет узлов)
+    atomic<bool>& stop;                 // Сигнал остановки для всех потоков (флаг движка)
+    atomic<uint64_t> total_nodes{0};    // Узлы всех потоков (обновляется порциями)
+
+    explicit SharedSearchState(atomic<bool>& stop_flag) : stop(stop_flag) {
+    }
+};
+
+// Один поток поиска: альфа-бета (negamax) с итеративным углублением.
+// Потоки Lazy SMP ищут из одного корня и обмениваются результатами
+// только через общую таблицу транспозиций.
+class SearchThread {
+private:
+    typedef SharedSearchState::Clock Clock;
+    static const uint64_t NODE_BATCH = 1024;  // Период проверки времени и сброса счетчика узлов
+
+    SharedSearchState& shared;
+    int id;                     // 0 - главный поток, остальные - помощники
+
+    // Проверка ограничений. Время и общий счетчик узлов проверяет только
+    // главный поток; помощники лишь следят за сигналом остановки.
+    bool checkStop() {
+        if ((nodes & (NODE_BATCH - 1)) == 0) {
+            shared.total_nodes.fetch_add(NODE_BATCH, memory_order_relaxed);
+            if (id == 0 && shared.limits.time_ms != 0 &&
+                chrono::duration_cast<chrono::milliseconds>(Clock::now() - shared.start).count() >= shared.limits.time_ms) {
+                shared.stop.store(true, memory_order_relaxed);
+            }
+        }
+        if (id == 0 && shared.limits.max_nodes != 0) {
+            // В однопоточном режиме узлы считаются точно - результат воспроизводим
+            uint64_t total = shared.single_thread ? nodes : shared.total_nodes.load(memory_order_relaxed);
+            if (total >= shared.limits.max_nodes) {
+                shared.stop.store(true, memory_order_relaxed);
+            }
+        }
+        return shared.stop.load(memory_order_relaxed);
+    }
+
+    // Перенос хода (from, to) в начало списка
+    static void moveToFront(MoveList& list, int from, int to) {
+        for (int i = 0; i < list.size(); ++i) {
+            if (list.moves[i].from == from && list.moves[i].to == to) {
+                rotate(list.moves, list.moves + i, list.moves + i + 1);
+                return;
+            }
+        }
+    }
+
+    int negamax(CheckersBoard& board, int depth, int alpha, int beta, int ply) {
+        ++nodes;
+        if (depth <= 0) {
+            PROFILE_COUNT(profile.qnodes);
+        }
+        if (checkStop()) {
+            return 0;
+        }
+        if (board.getReversiblePlies() >= DRAW_KING_PLIES) {
+            return 0;
+        }
+        // Позиция из эндшпильной базы - точная оценка без перебора
+        uint8_t tb_value;
+        bool tb_found = false;
+        if (shared.tablebase != nullptr) {
+            PROFILE_TIMED(profile, PHASE_TABLEBASE, tb_found = shared.tablebase->probe(board, tb_value));
+        }
+        if (tb_found) {
+            ++tb_hits;
+            if (tb_value == TB_DRAW) {
+                return 0;
+            }
+            return tb_value < TB_LOSS ? WIN_SCORE - ply - tb_value : -WIN_SCORE + ply + (tb_value - TB_LOSS);
+        }
+        MoveList list;
+        PROFILE_TIMED(profile, PHASE_MOVEGEN, board.generateMoves(list));
+        // Нечем ходить - проигрыш
+        if (list.empty()) {
+            return -WIN_SCORE + ply;
+        }
+        // На нулевой глубине продолжаем только обязательные взятия
+        if ((depth <= 0 && !list[0].isCapture()) || ply >= MAX_PLY) {
+            int static_score;
+            PROFILE_TIMED(profile, PHASE_EVAL, static_score = evaluate(board, *shared.weights));
+            return static_score;
+        }
+        
+        // Любая глубина <= 0 означает одно и то же: досчет взятий
+        depth = max(depth, 0);
+        uint64_t key = board.getHash();
+        TTEntry entry;
+        bool tt_found;
+        ++tt_probes;
+        PROFILE_TIMED(profile, PHASE_TT, tt_found = shared.tt->probe(key, entry));
+        if (tt_found) {
+            ++tt_hits;
+            if (entry.depth >= depth) {
+                int score = scoreFromTT(entry.score, ply);
+                if (entry.bound == Bound::EXACT ||
+                    (entry.bound == Bound::LOWER && score >= beta) ||
+                    (entry.bound == Bound::UPPER && score <= alpha)) {
+                    return score;
+                }
+            }
+            if (entry.move_from >= 0) {
+                moveToFront(list, entry.move_from, entry.move_to);
+            }
+        }
+        
+        int alpha_orig = alpha;
+        int best = -INF_SCORE;
+        const Move* best_move = nullptr;
+        Undo undo;
+        PROFILE_COUNT(profile.expanded);
+        for (const Move& move : list) {
+            PROFILE_COUNT(profile.children);
+            PROFILE_TIMED(profile, PHASE_MAKE_UNMAKE, board.doMove(move, undo));
+            int score = -negamax(board, depth - 1, -beta, -alpha, ply + 1);
+            PROFILE_TIMED(profile, PHASE_MAKE_UNMAKE, board.undoMove(undo));
+            if (shared.stop.load(memory_order_relaxed)) {
+                return 0;
+            }
+            if (score > best) {
+                best = score;
+                best_move = &move;
+                if (score > alpha) {
+                    alpha = score;
+                    if (alpha >= beta) {
+                        PROFILE_COUNT(profile.cutoffs);
+                        if (&move == &list[0]) {
+                            PROFILE_COUNT(profile.first_move_cutoffs);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+        
+        Bound bound = best >= beta ? Bound::LOWER : best > alpha_orig ? Bound::EXACT : Bound::UPPER;
+        PROFILE_TIMED(profile, PHASE_TT,
+                      shared.tt->store(key, scoreToTT(best, ply), depth, bound, best_move->from, best_move->to));
+        return best;
+    }
+
+public:
+    uint64_t nodes = 0;         // Узлы этого потока
+    uint64_t tt_probes = 0;     // Счетчики обращений к таблице
+    uint64_t tt_hits = 0;
+    uint64_t tb_hits = 0;       // Попадания в эндшпильные базы
+    SearchProfile profile;      // Счетчики и время фаз (при SHASHKI_PROFILE)
+
+    SearchThread(SharedSearchState& state, int thread_id)
+        : shared(state), id(thread_id) {
+    }
+
+    // Итеративное углубление из корня. Помощники начинают с разной глубины
+    // и перебирают корневые ходы со сдвигом, чтобы расходиться по дереву.
+    SearchResult iterate(const CheckersBoard& root) {
+#if SHASHKI_PROFILE
+        ProfileTimer search_timer(profile.search_ticks);
+#endif
+        SearchResult result;
+        CheckersBoard board = root;  // Рабочая копия: дальше только doMove/undoMove
+        MoveList list;
+        board.generateMoves(list);
+        if (list.empty()) {
+            return result;
+        }
+        result.best_move = list[0];
+        result.has_move = true;
+        
+        for (int depth = 1 + id % 2; depth <= shared.limits.max_depth; ++depth) {
+            // Лучший ход предыдущей итерации просматривается первым
+            Move ordered[MAX_MOVES];
+            int count = 0;
+            ordered[count++] = result.best_move;
+            for (int i = 0; i < list.size(); ++i) {
+                const Move& move = list[(i + id) % list.size()];
+                if (move.from != result.best_move.from || move.to != result.best_move.to ||
+                    move.captured != result.best_move.captured) {
+                    ordered[count++] = move;
+                }
+            }
+            
+            int alpha = -INF_SCORE;
+            Move best_move = ordered[0];
+            Undo undo;
+#if SHASHKI_PROFILE
+            uint64_t iteration_start = nodes;
+#endif
+            for (int i = 0; i < count; ++i) {
+                PROFILE_TIMED(profile, PHASE_MAKE_UNMAKE, board.doMove(ordered[i], undo));
+                int score = -negamax(board, depth - 1, -INF_SCORE, -alpha, 1);
+                PROFILE_TIMED(profile, PHASE_MAKE_UNMAKE, board.undoMove(undo));
+                if (shared.stop.load(memory_order_relaxed)) {
+                    break;
+                }
+                if (score > alpha) {
+                    alpha = score;
+                    best_move = ordered[i];
+                }
+            }
+            // Незавершенная итерация не учитывается
+            if (shared.stop.load(memory_order_relaxed)) {
+                break;
+            }
+            result.best_move = best_move;
+            result.score = alpha;
+            result.depth = depth;
+#if SHASHKI_PROFILE
+            profile.prev_iteration_nodes = profile.last_iteration_nodes;
+            profile.last_iteration_nodes = nodes - iteration_start;
+#endif
+            shared.tt->store(board.getHash(), scoreToTT(alpha, 0), depth, Bound::EXACT, best_move.from, best_move.to);
+            // Найден форсированный выигрыш или проигрыш - дальше углубляться незачем
+            if (abs(alpha) >= WIN_SCORE - WIN_BAND) {
+                break;
+            }
+        }
+        return result;
+    }
+};
+
+// Движок: таблица транспозиций и пул потоков поиска.
+// С одним потоком поиск полностью детерминирован.
+class Engine {
+private:
+    TranspositionTable tt;      // Таблица транспозиций, общая для всех потоков
+    int thread_count = 1;       // Число потоков поиска
+    const Tablebase* tablebase = nullptr;  // Эндшпильные базы (не принадлежат движку)
+    const OpeningBook* book = nullptr;     // Дебютная книга (не принадлежит движку)
+    uint64_t book_seed = 0;                // Выбор среди ходов книги
+    EvalWeights weights;                   // Веса оценки позиции
+    atomic<bool> stop_flag{false};         // Сигнал остановки текущего поиска
+    atomic<bool> halted{false};            // Движок остановлен: новые поиски сразу завершаются
+
+public:
+    explicit Engine(size_t hash_mb = DEFAULT_HASH_MB, int threads = 1)
+        : tt(hash_mb) {
+        setThreads(threads);
+    }
+
+    TranspositionTable& table() {
+        return tt;
+    }
+
+    void setThreads(int threads) {
+        thread_count = max(threads, 1);
+    }
+
+    int threads() const {
+        return thread_count;
+    }
+
+    void setTablebase(const Tablebase* tb) {
+        tablebase = tb;
+    }
+
+    void setWeights(const EvalWeights& eval_weights) {
+        weights = eval_weights;
+    }
+
+    // Разные seed дают разные (но воспроизводимые) дебюты
+    void setBook(const OpeningBook* opening_book, uint64_t seed) {
+        book = opening_book;
+        book_seed = seed;
+    }
+
+    // Остановка движка: текущий поиск вернет лучший ход последней итерации,
+    // последующие завершатся сразу. Можно вызывать из другого потока в любой момент -
+    // в том числе между выбором задачи и началом поиска, остановка не теряется.
+    void stop() {
+        halted.store(true);
+        stop_flag.store(true);
+    }
+
+    bool stopped() const {
+        return halted.load();
+    }
+
+    SearchResult search(const CheckersBoard& root, const Limits& limits) {
+        // Позиция из книги - ход без поиска
+        SearchResult book_result;
+        if (book != nullptr && book->probe(root, book_seed, book_result.best_move)) {
+            book_result.has_move = true;
+            book_result.from_book = true;
+            book_result.threads = thread_count;
+            return book_result;
+        }
+        
+#if SHASHKI_PROFILE
+        uint64_t start_ticks = profileTicks();
+#endif
+        // Флаг поиска сбрасывается (его ставят и ограничения), остановка движка - нет
+        stop_flag.store(false);
+        if (halted.load()) {
+            stop_flag.store(true);
+        }
+        SharedSearchState state(stop_flag);
+        state.tt = &tt;
+        state.tablebase = tablebase;
+        state.weights = &weights;
+        state.limits = limits;
+        state.start = SharedSearchState::Clock::now();
+        state.single_thread = (thread_count == 1);
+        tt.newSearch();
+        
+        vector<unique_ptr<SearchThread>> workers;
+        for (int i = 0; i < thread_count; ++i) {
+            workers.emplace_back(new SearchThread(state, i));
+        }
+        vector<thread> helpers;
+        for (int i = 1; i < thread_count; ++i) {
+            SearchThread* worker = workers[i].get();
+            helpers.emplace_back([worker, &root]() { worker->iterate(root); });
+        }
+        
+        // Ход выбирает главный поток; по его завершении останавливаются помощники
+        SearchResult result = workers[0]->iterate(root);
+        state.stop.store(true, memory_order_relaxed);
+        for (thread& helper : helpers) {
+            helper.join();
+        }
+        
+        result.threads = thread_count;
+        result.nodes = 0;
+        for (const auto& worker : workers) {
+            result.nodes += worker->nodes;
+            result.tt_probes += worker->tt_probes;
+            result.tt_hits += worker->tt_hits;
+            result.tb_hits += worker->tb_hits;
+            result.profile.add(worker->profile);
+        }
+        result.hashfull = tt.hashfull();
+        result.seconds = chrono::duration<double>(SharedSearchState::Clock::now() - state.start).count();
+#if SHASHKI_PROFILE
+        if (result.seconds > 0) {
+            result.profile.ticks_per_second = double(profileTicks() - start_ticks) / result.seconds;
+        }
+#endif
+        return result;
+    }
+};
+
+// Метод для выполнения хода компьютером
+void CheckersBoard::makeComputerMove(Engine& engine, const Limits& limits) {
+    SearchResult result = engine.search(*this, limits);
+    
+    // Если нашли возможные ходы
+    if (result.has_move) {
+        if (observer != nullptr) {
+            observer->onComputerMove(*this, result.best_move, result);
+        }
+        // Выполняем выбранный ход
+        commitMove(result.best_move);
+    } else {
+        // Если нет возможных ходов, игра заканчивается
+        game_over = true;
+        winner = (current_player == PieceColor::WHITE) ? PieceColor::BLACK : PieceColor::WHITE;
+        if (observer != nullptr) {
+            observer->onGameOver(*this);
+        }
+    }
+}
+
+// Счетчики поиска в формате JSON (поля без фигурных скобок). Время фаз -
+// сумма по потокам; search - остаток времени потоков (сам перебор и таймеры).
+void writeSearchJson(ostream& out, const SearchResult& result) {
+    out << "\"nodes\":" << result.nodes << ",\"seconds\":" << result.seconds << ",\"nps\":" << result.nps()
+        << ",\"tt_probes\":" << result.tt_probes << ",\"tt_hits\":" << result.tt_hits
+        << ",\"tt_hit_rate\":" << result.ttHitRate() << ",\"tb_hits\":" << result.tb_hits;
+#if SHASHKI_PROFILE
+    const SearchProfile& profile = result.profile;
+    out << ",\"qnodes\":" << profile.qnodes << ",\"cutoffs\":" << profile.cutoffs
+        << ",\"cutoff_rate\":" << profile.cutoffRate()
+        << ",\"first_move_cutoff_rate\":" << profile.firstMoveCutoffRate()
+        << ",\"branching_factor\":" << profile.branchingFactor()
+        << ",\"ebf\":" << profile.effectiveBranchingFactor() << ",\"phases\":{";
+    uint64_t measured = 0;
+    for (int i = 0; i < PROFILE_PHASES; ++i) {
+        out << '"' << PROFILE_PHASE_NAMES[i] << "\":" << profile.seconds(profile.ticks[i]) << ',';
+        measured += profile.ticks[i];
+    }
+    out << "\"search\":" << profile.seconds(profile.search_ticks > measured ? profile.search_ticks - measured : 0)
+        << '}';
+#endif
+}
+
+// Профиль партии: строка JSON на каждый ход движка и итоговая строка партии
+class GameProfile {
+private:
+    int game;                   // Номер партии в журнале
+    int moves = 0;              // Ходов движка
+    SearchResult total;         // Сумма счетчиков по ходам
+    ostringstream lines;
+
+public:
+    explicit GameProfile(int game_number) : game(game_number) {
+    }
+
+    // ply - номер полухода в партии, начиная с 1
+    void addMove(int ply, const Move& move, const SearchResult& result) {
+        lines << "{\"type\":\"move\",\"game\":" << game << ",\"ply\":" << ply << ",\"move\":\""
+              << moveToString(move) << "\",\"book\":" << (result.from_book ? "true" : "false")
+              << ",\"depth\":" << result.depth << ",\"score\":" << result.score << ",\"threads\":" << result.threads
+              << ',';
+        writeSearchJson(lines, result);
+        lines << "}\n";
+        
+        ++moves;
+        total.nodes += result.nodes;
+        total.tt_probes += result.tt_probes;
+        total.tt_hits += result.tt_hits;
+        total.tb_hits += result.tb_hits;
+        total.seconds += result.seconds;
+        total.profile.add(result.profile);
+    }
+
+    // Накопленные строки ходов (журнал пишется по ходу партии)
+    string takeLines() {
+        string text = lines.str();
+        lines.str("");
+        return text;
+    }
+
+    // Оставшиеся строки партии и итог (JSON Lines); result - white, black или draw.
+    // Счетчики обнуляются: профиль готов к следующей партии.
+    string finish(const string& result) {
+        lines << "{\"type\":\"game\",\"game\":" << game << ",\"result\":\"" << result << "\",\"moves\":" << moves
+              << ',';
+        writeSearchJson(lines, total);
+        lines << "}\n";
+        moves = 0;
+        total = SearchResult();
+        return takeLines();
+    }
+};
+
+// ========== PERFT ==========
+// Подсчет листьев дерева ходов заданной глубины: проверка генератора ходов
+// и замер его скорости. Разные пути взятия с одинаковым итогом считаются
+// разными ходами - так же считаются опубликованные значения для русских шашек.
+uint64_t perft(CheckersBoard& board, int depth) {
+    MoveList list;
+    board.generateMoves(list);
+    if (depth <= 1) {
+        return depth == 1 ? list.size() : 1;
+    }
+    uint64_t nodes = 0;
+    Undo undo;
+    for (const Move& move : list) {
+        board.doMove(move, undo);
+        nodes += perft(board, depth - 1);
+        board.undoMove(undo);
+    }
+    return nodes;
+}
+
+// Эталонные значения perft
+struct PerftReference {
+    const char* name;
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+};
+
+// Начальная позиция - опубликованные значения для русских шашек.
+// Остальные позиции сверены с независимой реализацией правил.
+const PerftReference PERFT_REFERENCES[] = {
+    { "начальная позиция", START_FEN, 1, 7 },
+    { "начальная позиция", START_FEN, 2, 49 },
+    { "начальная позиция", START_FEN, 3, 302 },
+    { "начальная позиция", START_FEN, 4, 1469 },
+    { "начальная позиция", START_FEN, 5, 7482 },
+    { "начальная позиция", START_FEN, 6, 37986 },
+    { "начальная позиция", START_FEN, 7, 190146 },
+    { "начальная позиция", START_FEN, 8, 929905 },
+    { "начальная позиция", START_FEN, 9, 4570667 },
+    { "превращение посреди взятия", "W:W9,21,22:B6,11,28,19", 7, 54359 },
+    { "серия взятий дамкой", "W:WK29:B22,14,1", 7, 517 },
+    { "дамки с обеих сторон", "W:WK1,K32,18,22,27:BK29,K4,10,12,15", 7, 88824 },
+    { "взятия назад", "B:W13,14,22,23,30:B5,6,10,18,27", 7, 2392 },
+    { "миттельшпиль", "W:W19,21,23,25,26,27,28,29,32:B1,2,3,4,6,11,12,14,20", 7, 181368 },
+};
+
+// Режим perft: Shashki perft [--fen FEN] [--depth N] [--divide] | [--verify]
+int runPerft(int argc, char* argv[]) {
+    string fen = START_FEN;
+    int depth = 6;
+    bool divide = false;
+    bool verify = false;
+    for (int i = 0; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--fen" && i + 1 < argc) {
+            fen = argv[++i];
+        } else if (arg == "--depth" && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (arg == "--divide") {
+            divide = true;
+        } else if (arg == "--verify") {
+            verify = true;
+        } else {
+            cout << "Неизвестный параметр perft: " << arg << endl;
+            return 1;
+        }
+    }
+    typedef chrono::steady_clock Clock;
+    
+    // Проверка по таблице эталонных значений
+    if (verify) {
+        int failed = 0;
+        uint64_t total_nodes = 0;
+        Clock::time_point start = Clock::now();
+        for (const PerftReference& ref : PERFT_REFERENCES) {
+            CheckersBoard board;
+            board.setPosition(ref.fen);
+            uint64_t nodes = perft(board, ref.depth);
+            total_nodes += nodes;
+            bool ok = (nodes == ref.nodes);
+            failed += ok ? 0 : 1;
+            cout << (ok ? "OK     " : "ОШИБКА ") << ref.name << ", глубина " << ref.depth
+                 << ": " << nodes << " (ожидалось " << ref.nodes << ")" << endl;
+        }
+        double seconds = chrono::duration<double>(Clock::now() - start).count();
+        cout << "Всего узлов: " << total_nodes << ", время " << seconds << " с, "
+             << uint64_t(total_nodes / max(seconds, 1e-9)) << " узлов/с" << endl;
+        cout << (failed == 0 ? "Все проверки пройдены" : "Есть расхождения: " + to_string(failed)) << endl;
+        return failed == 0 ? 0 : 1;
+    }
+    
+    CheckersBoard board;
+    if (!board.setPosition(fen)) {
+        cout << "Неверная позиция: " << fen << endl;
+        return 1;
+    }
+    Clock::time_point start = Clock::now();
+    uint64_t nodes = 0;
+    // Разбивка по ходам из корня
+    if (divide && depth >= 1) {
+        MoveList list;
+        board.generateMoves(list);
+        Undo undo;
+        for (const Move& move : list) {
+            board.doMove(move, undo);
+            uint64_t count = perft(board, depth - 1);
+            board.undoMove(undo);
+            nodes += count;
+            cout << moveToString(move) << ": " << count << endl;
+        }
+    } else {
+        nodes = perft(board, depth);
+    }
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    cout << "Позиция " << board.toFen() << ", глубина " << depth << ": " << nodes << " узлов, "
+         << seconds << " с, " << uint64_t(nodes / max(seconds, 1e-9)) << " узлов/с" << endl;
+    return 0;
+}
+
+// ========== МАТЧ МЕЖДУ ДВИЖКАМИ ==========
+// Настройки одного из движков матча
+struct EngineConfig {
+    Limits limits;                  // Ограничения поиска на ход
+    size_t hash_mb = 16;            // Размер таблицы транспозиций
+    EvalWeights weights;            // Веса оценки позиции
+
+    EngineConfig() {
+        limits.max_nodes = 20000;
+    }
+};
+
+// Параметры матча
+struct MatchOptions {
+    EngineConfig engines[2];        // Движки A и B
+    int games = 100;                // Число партий (каждый дебют играется дважды со сменой цвета)
+    int concurrency = 1;            // Партий одновременно
+    int max_plies = 200;            // Предел длины партии (дальше - ничья)
+    int opening_plies = 3;          // Глубина встроенного списка дебютов
+    uint64_t seed = 1;              // Начальное значение для порядка дебютов
+    string openings_file;           // Файл с позициями FEN (по одной на строку)
+    string tablebase_path;          // Каталог эндшпильных баз (общих для обоих движков)
+    string book_file;               // Дебютная книга (общая для обоих движков)
+    string pdn_file;                // Файл для записи сыгранных партий
+    string profile_file;            // Журнал профиля поиска (JSON Lines)
+};
+
+// Итог одной партии
+enum class GameOutcome { WHITE_WINS, BLACK_WINS, DRAW };
+
+// Все последовательности из opening_plies полуходов от начальной позиции
+// (в порядке генерации ходов); line - ходы, сделанные до board
+void collectOpenings(CheckersBoard& board, int plies, GameRecord& line, vector<GameRecord>& openings) {
+    if (plies == 0) {
+        openings.push_back(line);
+        return;
+    }
+    MoveList list;
+    board.generateMoves(list);
+    Undo undo;
+    for (const Move& move : list) {
+        board.doMove(move, undo);
+        line.moves.push_back(move);
+        collectOpenings(board, plies - 1, line, openings);
+        line.moves.pop_back();
+        board.undoMove(undo);
+    }
+}
+
+// Одна партия без вывода в консоль: из позиции opening.fen после ходов дебюта.
+// engines[0] играет белыми, engines[1] - черными. Все ходы партии
+// (включая дебютные) добавляются в moves.
+GameOutcome playEngineGame(const GameRecord& opening, Engine* engines[2], const Limits* limits[2], int max_plies,
+                           vector<Move>& moves, GameProfile* profile = nullptr) {
+    CheckersBoard board(PlayerType::COMPUTER, PlayerType::COMPUTER);
+    board.setPosition(opening.fen);
+    for (const Move& move : opening.moves) {
+        board.commitMove(move);
+        moves.push_back(move);
+    }
+    for (int ply = 0; ply < max_plies; ++ply) {
+        int side = (board.getCurrentPlayer() == PieceColor::WHITE) ? 0 : 1;
+        SearchResult result = engines[side]->search(board, *limits[side]);
+        if (!result.has_move) {
+            return side == 0 ? GameOutcome::BLACK_WINS : GameOutcome::WHITE_WINS;
+        }
+        if (profile != nullptr) {
+            profile->addMove(int(moves.size()) + 1, result.best_move, result);
+        }
+        board.commitMove(result.best_move);
+        moves.push_back(result.best_move);
+        if (board.isGameOver()) {
+            PieceColor winner = board.getWinner();
+            return winner == PieceColor::NONE ? GameOutcome::DRAW
+                 : winner == PieceColor::WHITE ? GameOutcome::WHITE_WINS : GameOutcome::BLACK_WINS;
+        }
+    }
+    return GameOutcome::DRAW;
+}
+
+// Разница в рейтинге Эло по доле набранных очков
+double eloFromScore(double score) {
+    score = min(max(score, 1e-6), 1.0 - 1e-6);
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+// Матч двух движков на пуле потоков. Партии с одним и тем же номером
+// всегда начинаются с одного дебюта, поэтому результат воспроизводим.
+void runMatch(const MatchOptions& options) {
+    typedef chrono::steady_clock Clock;
+    
+    // Список дебютов: позиции из файла или встроенные последовательности ходов
+    vector<GameRecord> openings;
+    if (!options.openings_file.empty()) {
+        ifstream file(options.openings_file);
+        string line;
+        CheckersBoard check;
+        while (getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty() && check.setPosition(line)) {
+                openings.push_back(GameRecord());
+                openings.back().fen = line;
+            }
+        }
+    } else {
+        CheckersBoard start;
+        GameRecord line;
+        collectOpenings(start, options.opening_plies, line, openings);
+    }
+    if (openings.empty()) {
+        cout << "Нет стартовых позиций для матча" << endl;
+        return;
+    }
+    // Перемешивание дебютов с фиксированным начальным значением
+    uint64_t state = options.seed;
+    for (size_t i = openings.size(); i > 1; --i) {
+        swap(openings[i - 1], openings[splitMix64(state) % i]);
+    }
+    
+    // Базы только читаются, поэтому одни на все потоки
+    Tablebase tablebase;
+    if (!options.tablebase_path.empty()) {
+        cout << "Загружено разделов эндшпильных баз: " << tablebase.load(options.tablebase_path) << endl;
+    }
+    OpeningBook book;
+    if (!options.book_file.empty() && !book.load(options.book_file)) {
+        cout << "Не удалось загрузить книгу: " << options.book_file << endl;
+        return;
+    }
+    ofstream pdn;
+    if (!options.pdn_file.empty()) {
+        pdn.open(options.pdn_file);
+        if (!pdn) {
+            cout << "Не удалось открыть файл партий: " << options.pdn_file << endl;
+            return;
+        }
+    }
+    ofstream profile_log;
+    if (!options.profile_file.empty()) {
+        profile_log.open(options.profile_file);
+        if (!profile_log) {
+            cout << "Не удалось открыть журнал профиля: " << options.profile_file << endl;
+            return;
+        }
+    }
+    
+    atomic<int> next_game{0};
+    atomic<int> wins{0}, draws{0}, losses{0};  // С точки зрения движка A
+    mutex output_mutex;
+    Clock::time_point start = Clock::now();
+    
+    auto worker = [&]() {
+        // У каждого потока свои движки: таблицы транспозиций не делятся между партиями
+        Engine engine_a(options.engines[0].hash_mb);
+        Engine engine_b(options.engines[1].hash_mb);
+        // Пустые базы не подключаются: иначе они опрашиваются в каждом узле впустую
+        if (tablebase.maxPieces() > 0) {
+            engine_a.setTablebase(&tablebase);
+            engine_b.setTablebase(&tablebase);
+        }
+        engine_a.setWeights(options.engines[0].weights);
+        engine_b.setWeights(options.engines[1].weights);
+        for (int game = next_game++; game < options.games; game = next_game++) {
+            // Партии 2k и 2k+1 играются из одного дебюта со сменой цвета
+            const GameRecord& opening = openings[(game / 2) % openings.size()];
+            bool a_is_white = (game % 2 == 0);
+            Engine* engines[2] = { a_is_white ? &engine_a : &engine_b, a_is_white ? &engine_b : &engine_a };
+            const Limits* limits[2] = { &options.engines[a_is_white ? 0 : 1].limits,
+                                        &options.engines[a_is_white ? 1 : 0].limits };
+            engine_a.table().clear();
+            engine_b.table().clear();
+            // Обе партии пары получают одинаковый выбор ходов книги
+            if (book.size() != 0) {
+                engine_a.setBook(&book, options.seed + game / 2);
+                engine_b.setBook(&book, options.seed + game / 2);
+            }
+            GameRecord record;
+            record.fen = opening.fen;
+            GameProfile profile(game + 1);
+            GameOutcome outcome = playEngineGame(opening, engines, limits, options.max_plies, record.moves,
+                                                 profile_log.is_open() ? &profile : nullptr);
+            if (profile_log.is_open()) {
+                string lines = profile.finish(outcome == GameOutcome::DRAW ? "draw"
+                                              : outcome == GameOutcome::WHITE_WINS ? "white" : "black");
+                lock_guard<mutex> lock(output_mutex);
+                profile_log << lines;
+            }
+            if (pdn.is_open()) {
+                record.winner = outcome == GameOutcome::DRAW ? PieceColor::NONE
+                              : outcome == GameOutcome::WHITE_WINS ? PieceColor::WHITE : PieceColor::BLACK;
+                lock_guard<mutex> lock(output_mutex);
+                writePdnGame(pdn, record, "Shashki match");
+            }
+            
+            if (outcome == GameOutcome::DRAW) {
+                ++draws;
+            } else if ((outcome == GameOutcome::WHITE_WINS) == a_is_white) {
+                ++wins;
+            } else {
+                ++losses;
+            }
+            int played = wins + draws + losses;
+            if (played % 100 == 0) {
+                lock_guard<mutex> lock(output_mutex);
+                cout << "Сыграно " << played << " из " << options.games << endl;
+            }
+        }
+    };
+    vector<thread> pool;
+    for (int i = 0; i < max(options.concurrency, 1); ++i) {
+        pool.emplace_back(worker);
+    }
+    for (thread& t : pool) {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    
+    // Итог с точки зрения движка A: доля очков, Эло и 95% доверительный интервал
+    int n = wins + draws + losses;
+    if (n == 0) {
+        return;
+    }
+    double score = (wins + 0.5 * draws) / n;
+    double variance = (wins * (1.0 - score) * (1.0 - score) + draws * (0.5 - score) * (0.5 - score)
+                       + losses * score * score) / n;
+    double margin = 1.96 * sqrt(variance / n);
+    double elo = eloFromScore(score);
+    double elo_error = (eloFromScore(score + margin) - eloFromScore(score - margin)) / 2;
+    cout << "Партий: " << n << ", дебютов: " << openings.size() << endl;
+    cout << "A: +" << wins << " =" << draws << " -" << losses
+         << " (" << fixed << setprecision(1) << score * 100 << "%)" << endl;
+    cout << "Разница Эло (A - B): " << elo << " +/- " << elo_error << endl;
+    cout << "Время: " << seconds << " с, " << setprecision(2) << n / max(seconds, 1e-9) << " партий/с" << endl;
+    cout.unsetf(ios::floatfield);
+}
+
+// Разбор параметров движка: --a-depth, --b-nodes, --a-time, --b-hash, --a-eval
+bool parseEngineOption(const string& arg, const char* value, MatchOptions& options) {
+    if (arg.size() < 4 || arg[0] != '-' || arg[1] != '-' || (arg[2] != 'a' && arg[2] != 'b') || arg[3] != '-') {
+        return false;
+    }
+    EngineConfig& config = options.engines[arg[2] == 'a' ? 0 : 1];
+    string name = arg.substr(4);
+    if (name == "depth") {
+        config.limits.max_depth = atoi(value);
+    } else if (name == "nodes") {
+        config.limits.max_nodes = strtoull(value, nullptr, 10);
+    } else if (name == "time") {
+        config.limits.time_ms = atoi(value);
+    } else if (name == "hash") {
+        config.hash_mb = strtoul(value, nullptr, 10);
+    } else if (name == "eval") {
+        if (!config.weights.load(value)) {
+            cout << "Не удалось загрузить веса оценки: " << value << endl;
+            return false;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Режим матча: Shashki match [--games N] [--concurrency N] [--max-plies N] [--seed N]
+//                            [--opening-plies N | --openings FILE] [--tb-path DIR]
+//                            [--book FILE] [--pdn FILE]
+//                            [--a-/--b-depth|nodes|time|hash N] [--a-/--b-eval FILE]
+int runMatchMode(int argc, char* argv[]) {
+    MatchOptions options;
+    for (int i = 0; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cout << "Не задано значение параметра: " << arg << endl;
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--games") {
+            options.games = atoi(value);
+        } else if (arg == "--concurrency") {
+            options.concurrency = atoi(value);
+        } else if (arg == "--max-plies") {
+            options.max_plies = atoi(value);
+        } else if (arg == "--seed") {
+            options.seed = strtoull(value, nullptr, 10);
+        } else if (arg == "--opening-plies") {
+            options.opening_plies = atoi(value);
+        } else if (arg == "--openings") {
+            options.openings_file = value;
+        } else if (arg == "--tb-path") {
+            options.tablebase_path = value;
+        } else if (arg == "--book") {
+            options.book_file = value;
+        } else if (arg == "--pdn") {
+            options.pdn_file = value;
+        } else if (arg == "--profile") {
+            options.profile_file = value;
+        } else if (!parseEngineOption(arg, value, options)) {
+            cout << "Неизвестный параметр матча: " << arg << endl;
+            return 1;
+        }
+    }
+    runMatch(options);
+    return 0;
+}
+
+// ========== НАСТРОЙКА ВЕСОВ ==========
+// Настройка весов оценки по методу Texel: веса подбираются так, чтобы
+// sigmoid(K * оценка) лучше всего предсказывала итог партии, из которой взята
+// позиция. Выборка - двоичный файл позиций, извлеченных из партий PDN;
+// при настройке он читается порциями, поэтому может не помещаться в память.
+
+// Позиция выборки (с точки зрения белых)
+struct TrainingPosition {
+    Bitboard white_men, white_kings, black_men, black_kings;
+    uint8_t black_to_move;
+    uint8_t result;         // Итог партии для белых: 0 - поражение, 1 - ничья, 2 - победа
+    uint16_t reserved;
+};
+
+// Заголовок файла выборки; за ним следуют count позиций
+struct DatasetHeader {
+    char magic[8];          // "SHASHDS1"
+    uint64_t count;
+};
+
+const char DATASET_MAGIC[8] = { 'S', 'H', 'A', 'S', 'H', 'D', 'S', '1' };
+
+// Извлечение выборки из партий: берутся спокойные позиции (без обязательного
+// взятия) после первых skip_plies полуходов
+bool writeDataset(const vector<GameRecord>& games, int skip_plies, const string& path) {
+    ofstream out(path, ios::binary);
+    DatasetHeader header = {};
+    copy(DATASET_MAGIC, DATASET_MAGIC + 8, header.magic);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    
+    CheckersBoard board(PlayerType::COMPUTER, PlayerType::COMPUTER);
+    MoveList list;
+    for (const GameRecord& game : games) {
+        uint8_t result = game.winner == PieceColor::WHITE ? 2 : game.winner == PieceColor::NONE ? 1 : 0;
+        board.setPosition(game.fen);
+        for (size_t i = 0; i < game.moves.size(); ++i) {
+            board.generateMoves(list);
+            if (int(i) >= skip_plies && !list[0].isCapture()) {
+                TrainingPosition position = {};
+                position.white_men = board.menOf(PieceColor::WHITE);
+                position.white_kings = board.kingsOf(PieceColor::WHITE);
+                position.black_men = board.menOf(PieceColor::BLACK);
+                position.black_kings = board.kingsOf(PieceColor::BLACK);
+                position.black_to_move = board.getCurrentPlayer() == PieceColor::BLACK ? 1 : 0;
+                position.result = result;
+                out.write(reinterpret_cast<const char*>(&position), sizeof(position));
+                ++header.count;
+            }
+            board.applyMove(game.moves[i]);
+        }
+    }
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out) {
+        cout << "Не удалось записать выборку: " << path << endl;
+        return false;
+    }
+    cout << "Партий: " << games.size() << ", позиций: " << header.count << endl;
+    return true;
+}
+
+// Режим извлечения выборки: Shashki dataset --pdn FILE [--pdn FILE ...] [--out FILE] [--skip-plies N]
+int runDatasetMode(int argc, char* argv[]) {
+    vector<string> inputs;
+    string path = "dataset.bin";
+    int skip_plies = 8;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--pdn") {
+            inputs.push_back(argv[i + 1]);
+        } else if (arg == "--out") {
+            path = argv[i + 1];
+        } else if (arg == "--skip-plies") {
+            skip_plies = atoi(argv[i + 1]);
+        } else {
+            cout << "Неизвестный параметр выборки: " << arg << endl;
+            return 1;
+        }
+    }
+    if (inputs.empty()) {
+        cout << "Не заданы файлы партий (--pdn FILE)" << endl;
+        return 1;
+    }
+    vector<GameRecord> games;
+    for (const string& input : inputs) {
+        ifstream file(input);
+        if (!file) {
+            cout << "Не удалось открыть файл: " << input << endl;
+            return 1;
+        }
+        readPdnGames(file, games);
+    }
+    return writeDataset(games, skip_plies, path) ? 0 : 1;
+}
+
+// Последовательное чтение выборки порциями
+class DatasetReader {
+private:
+    ifstream file;
+    uint64_t total = 0;
+    uint64_t position = 0;
+
+public:
+    bool open(const string& path) {
+        file.open(path, ios::binary);
+        DatasetHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            !equal(DATASET_MAGIC, DATASET_MAGIC + 8, header.magic)) {
+            return false;
+        }
+        total = header.count;
+        position = 0;
+        return true;
+    }
+
+    uint64_t size() const {
+        return total;
+    }
+
+    void rewind() {
+        file.clear();
+        file.seekg(sizeof(DatasetHeader));
+        position = 0;
+    }
+
+    // Следующие (не более max_count) позиции; 0 - конец файла
+    size_t next(vector<TrainingPosition>& chunk, size_t max_count) {
+        size_t count = size_t(min<uint64_t>(max_count, total - position));
+        chunk.resize(count);
+        if (count != 0 && !file.read(reinterpret_cast<char*>(chunk.data()), streamsize(count * sizeof(TrainingPosition)))) {
+            count = size_t(file.gcount() / sizeof(TrainingPosition));
+            chunk.resize(count);
+        }
+        position += count;
+        return count;
+    }
+};
+
+// Сумма квадратов ошибок и градиент по весам на части порции
+struct TuneGradient {
+    double loss = 0;
+    double g[EVAL_TERMS] = {};
+};
+
+inline double tuneSigmoid(double score, double k) {
+    return 1.0 / (1.0 + exp(-k * score));
+}
+
+void tuneGradient(const TrainingPosition* positions, size_t count, const double weights[EVAL_TERMS], double k,
+                  TuneGradient& out) {
+    for (size_t i = 0; i < count; ++i) {
+        const TrainingPosition& p = positions[i];
+        int features[EVAL_TERMS];
+        evalFeatures<popCount>(p.white_men, p.white_kings, p.black_men, p.black_kings, p.black_to_move, features);
+        double score = 0;
+        for (int t = 0; t < EVAL_TERMS; ++t) {
+            score += weights[t] * features[t];
+        }
+        double predicted = tuneSigmoid(score, k);
+        double error = predicted - p.result * 0.5;
+        out.loss += error * error;
+        double d = 2.0 * error * predicted * (1.0 - predicted) * k;
+        for (int t = 0; t < EVAL_TERMS; ++t) {
+            out.g[t] += d * features[t];
+        }
+    }
+}
+
+// Средняя ошибка целочисленных весов (как их видит движок) на выборке в памяти
+double tuneError(const PositionBatch& batch, const vector<uint8_t>& results, const EvalWeights& weights, double k) {
+    vector<int> scores(batch.size());
+    evaluateBatch(batch, weights, scores.data());
+    double loss = 0;
+    for (size_t i = 0; i < scores.size(); ++i) {
+        // Оценка пакета - с точки зрения ходящего, результат - с точки зрения белых
+        double score = batch.black_to_move[i] ? -scores[i] : scores[i];
+        double error = tuneSigmoid(score, k) - results[i] * 0.5;
+        loss += error * error;
+    }
+    return scores.empty() ? 0 : loss / double(scores.size());
+}
+
+// Параметры настройки
+struct TuneOptions {
+    string data_file;               // Выборка (режим dataset)
+    string weights_in;              // Начальные веса (по умолчанию - встроенные)
+    string weights_out = "weights.txt";
+    int epochs = 20;                // Проходов по выборке
+    int threads = 0;                // 0 - по числу ядер
+    size_t batch = 262144;          // Позиций на один шаг оптимизатора
+    double rate = 0.5;              // Шаг Adam (в единицах весов)
+    size_t sample = 1000000;        // Позиций для подбора K и контроля ошибки
+};
+
+// Настройка: K подбирается на начале выборки при исходных весах, затем веса
+// (кроме веса простой шашки, задающего масштаб) обновляются методом Adam после
+// каждой порции. Градиент порции считается параллельно всеми потоками.
+int runTune(const TuneOptions& options) {
+    typedef chrono::steady_clock Clock;
+    DatasetReader reader;
+    if (!reader.open(options.data_file)) {
+        cout << "Не удалось открыть выборку: " << options.data_file << endl;
+        return 1;
+    }
+    EvalWeights weights;
+    if (!options.weights_in.empty() && !weights.load(options.weights_in)) {
+        cout << "Не удалось загрузить веса оценки: " << options.weights_in << endl;
+        return 1;
+    }
+    int threads = options.threads > 0 ? options.threads : max(int(thread::hardware_concurrency()), 1);
+    
+    // Контрольная часть выборки в виде пакета
+    vector<TrainingPosition> chunk;
+    reader.next(chunk, options.sample);
+    PositionBatch sample;
+    vector<uint8_t> results;
+    for (const TrainingPosition& p : chunk) {
+        sample.white_men.push_back(p.white_men);
+        sample.white_kings.push_back(p.white_kings);
+        sample.black_men.push_back(p.black_men);
+        sample.black_kings.push_back(p.black_kings);
+        sample.black_to_move.push_back(p.black_to_move);
+        results.push_back(p.result);
+    }
+    if (sample.size() == 0) {
+        cout << "Выборка пуста" << endl;
+        return 1;
+    }
+    
+    // Подбор K тернарным поиском (ошибка по K унимодальна)
+    double low = 1e-4, high = 0.1;
+    for (int i = 0; i < 60; ++i) {
+        double a = low + (high - low) / 3;
+        double b = high - (high - low) / 3;
+        if (tuneError(sample, results, weights, a) < tuneError(sample, results, weights, b)) {
+            high = b;
+        } else {
+            low = a;
+        }
+    }
+    double k = (low + high) / 2;
+    cout << "Позиций: " << reader.size() << ", потоков: " << threads << ", K = " << k
+         << ", исходная ошибка " << tuneError(sample, results, weights, k) << endl;
+    
+    double w[EVAL_TERMS], m[EVAL_TERMS] = {}, v[EVAL_TERMS] = {};
+    copy(weights.values, weights.values + EVAL_TERMS, w);
+    const double BETA1 = 0.9, BETA2 = 0.999, EPSILON = 1e-8;
+    uint64_t step = 0;
+    Clock::time_point start = Clock::now();
+    
+    for (int epoch = 1; epoch <= options.epochs; ++epoch) {
+        reader.rewind();
+        double epoch_loss = 0;
+        uint64_t epoch_positions = 0;
+        while (size_t count = reader.next(chunk, options.batch)) {
+            // Части порции по потокам
+            vector<TuneGradient> parts(threads);
+            vector<thread> pool;
+            size_t per_thread = (count + threads - 1) / threads;
+            for (int t = 0; t < threads; ++t) {
+                size_t begin = min(count, t * per_thread);
+                size_t end = min(count, begin + per_thread);
+                pool.emplace_back([&, t, begin, end]() {
+                    tuneGradient(chunk.data() + begin, end - begin, w, k, parts[t]);
+                });
+            }
+            for (thread& worker : pool) {
+                worker.join();
+            }
+            TuneGradient total;
+            for (const TuneGradient& part : parts) {
+                total.loss += part.loss;
+                for (int t = 0; t < EVAL_TERMS; ++t) {
+                    total.g[t] += part.g[t];
+                }
+            }
+            epoch_loss += total.loss;
+            epoch_positions += count;
+            
+            ++step;
+            for (int t = 0; t < EVAL_TERMS; ++t) {
+                if (t == TERM_MAN) {
+                    continue;
+                }
+                double g = total.g[t] / double(count);
+                m[t] = BETA1 * m[t] + (1 - BETA1) * g;
+                v[t] = BETA2 * v[t] + (1 - BETA2) * g * g;
+                double m_hat = m[t] / (1 - pow(BETA1, double(step)));
+                double v_hat = v[t] / (1 - pow(BETA2, double(step)));
+                w[t] -= options.rate * m_hat / (sqrt(v_hat) + EPSILON);
+            }
+        }
+        
+        for (int t = 0; t < EVAL_TERMS; ++t) {
+            weights.values[t] = int(lround(w[t]));
+        }
+        double seconds = chrono::duration<double>(Clock::now() - start).count();
+        cout << "Эпоха " << epoch << ": ошибка " << epoch_loss / double(max<uint64_t>(epoch_positions, 1))
+             << " (целые веса: " << tuneError(sample, results, weights, k) << "), "
+             << epoch / seconds << " эпох/с, " << uint64_t(double(epoch_positions) * epoch / seconds) << " позиций/с" << endl;
+    }
+    
+    if (!weights.save(options.weights_out)) {
+        cout << "Не удалось записать веса: " << options.weights_out << endl;
+        return 1;
+    }
+    for (int t = 0; t < EVAL_TERMS; ++t) {
+        cout << EVAL_TERM_NAMES[t] << " " << weights.values[t] << endl;
+    }
+    return 0;
+}
+
+// Режим настройки: Shashki tune --data FILE [--eval FILE] [--out FILE] [--epochs N]
+//                                [--threads N] [--batch N] [--rate X] [--sample N]
+int runTuneMode(int argc, char* argv[]) {
+    TuneOptions options;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        const char* value = argv[i + 1];
+        if (arg == "--data") {
+            options.data_file = value;
+        } else if (arg == "--eval") {
+            options.weights_in = value;
+        } else if (arg == "--out") {
+            options.weights_out = value;
+        } else if (arg == "--epochs") {
+            options.epochs = atoi(value);
+        } else if (arg == "--threads") {
+            options.threads = atoi(value);
+        } else if (arg == "--batch") {
+            options.batch = max<size_t>(strtoull(value, nullptr, 10), 1);
+        } else if (arg == "--rate") {
+            options.rate = atof(value);
+        } else if (arg == "--sample") {
+            options.sample = max<size_t>(strtoull(value, nullptr, 10), 1);
+        } else {
+            cout << "Неизвестный параметр настройки: " << arg << endl;
+            return 1;
+        }
     }
+    if (options.data_file.empty()) {
+        cout << "Не задана выборка (--data FILE)" << endl;
+        return 1;
+    }
+    return runTune(options);
+}
+
+// ========== СЕРВЕР ПАРТИЙ ==========
+// Много одновременных партий в одном процессе. Команды - строки на stdin,
+// ответы - строки на stdout; каждый ответ начинается со слова-типа и номера партии:
+//   new [FEN]                      -> new <id>
+//   move <id> <ход>                -> ok <id>
+//   go <id> [nodes N] [time MS] [depth N]
+//                                  -> bestmove <id> <ход|none> <оценка> <глубина> <узлы>
+//   state <id>                     -> state <id> <FEN> <play|white|black|draw>
+//   close <id>                     -> closed <id>
+//   stats                          -> stats sessions N queued N done N avg_ms X max_ms X
+//   quit                           -> идущие поиски останавливаются (ответ - лучший найденный
+//                                     ход), go из очереди отклоняются (shutdown), выход
+// В конце ввода (без quit) сервер завершается после ответа на все принятые go.
+// Ошибки: error <id|-> <причина>. Ответы на go приходят по мере готовности и
+// могут обгонять друг друга; пока по партии идет поиск, другие команды к ней
+// отвергаются (busy).
+
+const size_t SERVER_BLOCK_SESSIONS = 1024;       // Партий в одном блоке пула
+const uint32_t SERVER_MAX_SESSIONS = 1u << 20;   // Предел одновременных партий
+
+// Партия на сервере
+struct ServerSession {
+    CheckersBoard board;
+    uint64_t id = 0;             // 0 - ячейка свободна
+    uint32_t generation = 0;     // Сколько раз ячейка освобождалась (номер партии не повторяется)
+    atomic<bool> busy{false};    // Идет поиск: партия принадлежит рабочему потоку
 };
 
-// ========== КЛАСС ИГРОВОЙ ДОСКИ ==========
-class CheckersBoard {
+// Пул партий: блоки фиксированного размера и список свободных ячеек.
+// Блоки не перемещаются, поэтому указатель на партию остается верным,
+// пока ее обрабатывает рабочий поток. Номер партии - generation * SERVER_MAX_SESSIONS + ячейка.
+// Пулом пользуется только поток чтения команд.
+class SessionPool {
 private:
-static const int SIZE = 8;  // Размер доски (8x8)
-     vector<vector<Piece>> board;  // Двумерный вектор для хранения состояния доски
-    PieceColor current_player;    // Текущий игрок (чей ход)
-    bool game_over;              // Флаг окончания игры
-    int white_pieces;           // Количество белых шашек
-    int black_pieces;           // Количество черных шашек
-    PlayerType white_player;     // Тип игрока для белых
-    PlayerType black_player;     // Тип игрока для черных
+    vector<unique_ptr<ServerSession[]>> blocks;
+    vector<uint32_t> free_slots;
+    size_t active = 0;
 
-public:
-    // Конструктор
-    CheckersBoard(PlayerType white = PlayerType::HUMAN,
-        PlayerType black = PlayerType::COMPUTER);
-: current_player(PieceColor::WHITE), // Белые ходят первыми
-          game_over(false),                 // Игра только начинается
-          white_pieces(12),                 // Начальное количество белых шашек
-          black_pieces(12),                 // Начальное количество черных шашек
-          white_player(white),              // Установка типа игрока для белых
-          black_player(black) {             // Установка типа игрока для черных
-        board.resize(SIZE, vector<Piece>(SIZE));  // Инициализация доски
-        setupBoard();                            // Начальная расстановка шашек
-        srand(time(0));                          // Инициализация генератора случайных чисел
+    ServerSession& slot(uint32_t index) {
+        return blocks[index / SERVER_BLOCK_SESSIONS][index % SERVER_BLOCK_SESSIONS];
     }
 
-    // Настройка начальной позиции
-    void setupBoard() {
-        // Проходим по всем клеткам доски
-        for (int row = 0; row < SIZE; ++row) {
-            for (int col = 0; col < SIZE; ++col) {
-                // Шашки располагаются только на черных клетках (где сумма row+col нечетная)
-                if ((row + col) % 2 == 1) {
-                    // Первые 3 ряда - черные шашки
-                    if (row < 3) {
-                        board[row][col] = Piece(PieceColor::BLACK);
-                    } 
-                    // Последние 3 ряда - белые шашки
-                    else if (row > 4) {
-                        board[row][col] = Piece(PieceColor::WHITE);
-                    } 
-                    // Средние 2 ряда - пустые клетки
-                    else {
-                        board[row][col] = Piece(PieceColor::NONE);
-                    }
-                } 
-                // Белые клетки всегда пустые
-                else {
-                    board[row][col] = Piece(PieceColor::NONE);
-                }
+public:
+    // Новая партия (nullptr, если достигнут предел)
+    ServerSession* acquire() {
+        if (free_slots.empty()) {
+            size_t first = blocks.size() * SERVER_BLOCK_SESSIONS;
+            if (first >= SERVER_MAX_SESSIONS) {
+                return nullptr;
+            }
+            blocks.emplace_back(new ServerSession[SERVER_BLOCK_SESSIONS]);
+            for (size_t i = SERVER_BLOCK_SESSIONS; i-- > 0;) {
+                free_slots.push_back(uint32_t(first + i));
             }
         }
+        uint32_t index = free_slots.back();
+        free_slots.pop_back();
+        ServerSession& session = slot(index);
+        session.id = uint64_t(session.generation) * SERVER_MAX_SESSIONS + index + 1;
+        ++active;
+        return &session;
     }
 
-    // Метод для отображения доски в консоли
-    void printBoard() const {
-        // Вывод номеров столбцов
-        cout << "  ";
-        for (int col = 0; col < SIZE; ++col) {
-            cout << col << " ";
+    // Партия по номеру (nullptr, если такой нет)
+    ServerSession* find(uint64_t id) {
+        if (id == 0) {
+            return nullptr;
         }
-        cout << endl;
-        
-        // Вывод каждой строки доски
-        for (int row = 0; row < SIZE; ++row) {
-            cout << row << " ";  // Номер строки
-            for (int col = 0; col < SIZE; ++col) {
-                // Вывод символа для белой шашки
-                if (board[row][col].color == PieceColor::WHITE) {
-                    cout << (board[row][col].is_king ? "W " : "w ");
-                } 
-                // Вывод символа для черной шашки
-                else if (board[row][col].color == PieceColor::BLACK) {
-                    cout << (board[row][col].is_king ? "B " : "b ");
-                } 
-                // Вывод символа для пустой клетки
-                else {
-                    cout << ". ";
-                }
-            }
-            cout << endl;
+        uint64_t index = (id - 1) % SERVER_MAX_SESSIONS;
+        if (index >= blocks.size() * SERVER_BLOCK_SESSIONS) {
+            return nullptr;
         }
+        ServerSession& session = slot(uint32_t(index));
+        return session.id == id ? &session : nullptr;
     }
-    
-    // Метод для проверки, находится ли клетка в пределах доски
-    bool isOnBoard(int row, int col) const {
-        return row >= 0 && row < SIZE && col >= 0 && col < SIZE;
+
+    void release(ServerSession* session) {
+        uint32_t index = uint32_t((session->id - 1) % SERVER_MAX_SESSIONS);
+        session->id = 0;
+        ++session->generation;
+        free_slots.push_back(index);
+        --active;
     }
+
+    size_t size() const {
+        return active;
+    }
+};
+
+// Параметры сервера
+struct ServerOptions {
+    int workers = 0;                // Рабочих потоков (0 - по числу ядер)
+    size_t hash_mb = 16;            // Таблица транспозиций каждого рабочего потока
+    Limits limits;                  // Ограничения go без параметров
+    int max_time_ms = 1000;         // Предел времени на ход (ограничивает задержку ответа)
+    size_t max_queue = 4096;        // Предел очереди go (сверх него - overloaded)
+    string tablebase_path;          // Каталог эндшпильных баз
+    string book_file;               // Дебютная книга
+    EvalWeights weights;            // Веса оценки позиции
+};
+
+class GameServer {
+private:
+    typedef chrono::steady_clock Clock;
+
+    // Запрос хода
+    struct Job {
+        ServerSession* session;
+        uint64_t id;
+        Limits limits;
+        Clock::time_point queued;
+    };
+
+    ServerOptions options;
+    Tablebase tablebase;
+    OpeningBook book;
+    SessionPool sessions;
+    vector<unique_ptr<Engine>> engines;  // По движку на рабочий поток
     
-    // Метод для проверки валидности хода
-    bool isValidMove(int from_row, int from_col, int to_row, int to_col) {
-        // Проверка, что начальная и конечная позиции на доске
-        if (!isOnBoard(from_row, from_col) || !isOnBoard(to_row, to_col)) {
-            return false;
-        }
-        
-        // Проверка, что в начальной позиции стоит шашка текущего игрока
-        if (board[from_row][from_col].color != current_player) {
-            return false;
-        }
-        
-        // Проверка, что конечная позиция пуста
-        if (board[to_row][to_col].color != PieceColor::NONE) {
-            return false;
-        }
-        
-        // Шашки ходят только по черным клеткам (где сумма координат нечетная)
-        if ((to_row + to_col) % 2 != 1) {
-            return false;
+    mutex queue_mutex;
+    condition_variable queue_ready;
+    deque<Job> queue;
+    bool stopping = false;
+    
+    mutex output_mutex;             // Строки ответов не перемешиваются
+    atomic<uint64_t> done{0};       // Обработано запросов go
+    atomic<uint64_t> latency_us{0}; // Суммарная задержка ответов на go
+    atomic<uint64_t> max_latency_us{0};
+
+    void reply(const string& line) {
+        lock_guard<mutex> lock(output_mutex);
+        cout << line << '\n' << flush;
+    }
+
+    void replyError(const string& id, const string& reason) {
+        reply("error " + id + " " + reason);
+    }
+
+    // Состояние партии: play или итог (white, black, draw)
+    static string status(const CheckersBoard& board) {
+        PieceColor winner = board.getWinner();
+        if (!board.isGameOver()) {
+            MoveList list;
+            board.generateMoves(list);
+            if (!list.empty()) {
+                return "play";
+            }
+            winner = board.getCurrentPlayer() == PieceColor::WHITE ? PieceColor::BLACK : PieceColor::WHITE;
         }
-        
-        // Вычисление разницы между начальной и конечной позицией
-        int row_diff = to_row - from_row;
-        int col_diff = to_col - from_col;
-        
-        // Проверка хода для обычной шашки (не дамки)
-        if (!board[from_row][from_col].is_king) {
-            // Проверка направления хода (белые ходят вверх, черные - вниз)
-            if (current_player == PieceColor::WHITE) {
-                // Белые могут ходить только на -1 или -2 по строке
-                if (row_diff != -1 && row_diff != -2) {
-                    return false;
-                }
-            } else {
-                // Черные могут ходить только на +1 или +2 по строке
-                if (row_diff != 1 && row_diff != 2) {
-                    return false;
+        return winner == PieceColor::WHITE ? "white" : winner == PieceColor::BLACK ? "black" : "draw";
+    }
+
+    // Рабочий поток: собственный движок, запросы из общей очереди
+    void workerLoop(Engine& engine) {
+        while (true) {
+            Job job;
+            {
+                unique_lock<mutex> lock(queue_mutex);
+                queue_ready.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    return;
                 }
+                job = queue.front();
+                queue.pop_front();
             }
             
-            // Ход должен быть строго по диагонали
-            if (abs(col_diff) != abs(row_diff)) {
-                return false;
-            }
-            
-            // Простой ход (без взятия)
-            if (abs(row_diff) == 1) {
-                return true;
+            // Задача взята до quit, но движок уже остановлен - поиск не начинается
+            ServerSession& session = *job.session;
+            if (engine.stopped()) {
+                session.busy.store(false, memory_order_release);
+                replyError(to_string(job.id), "shutdown");
+                continue;
             }
-            // Ход с взятием (через одну клетку)
-            else if (abs(row_diff) == 2) {
-                // Позиция шашки противника, которую бьем
-                int mid_row = (from_row + to_row) / 2;
-                int mid_col = (from_col + to_col) / 2;
-                
-                // Проверка, что между начальной и конечной позицией стоит шашка противника
-                if (board[mid_row][mid_col].color != PieceColor::NONE && 
-                    board[mid_row][mid_col].color != current_player) {
-                    return true;
-                }
+            // Номер партии как seed: разные партии играют разные дебюты
+            if (book.size() != 0) {
+                engine.setBook(&book, job.id);
             }
-            return false;
-        }
-        // Проверка хода для дамки
-        else {
-            // Дамка ходит по диагонали на любое расстояние
-            if (abs(row_diff) != abs(col_diff)) {
-                return false;
+            SearchResult result = engine.search(session.board, job.limits);
+            ostringstream line;
+            line << "bestmove " << job.id << ' ';
+            if (result.has_move) {
+                // Запись до хода: неоднозначное взятие передается полным путем
+                line << moveToText(session.board, result.best_move);
+                session.board.commitMove(result.best_move);
+            } else {
+                line << "none";
             }
+            line << ' ' << result.score << ' ' << result.depth << ' ' << result.nodes;
             
-            // Определение направления движения
-            int row_step = (row_diff > 0) ? 1 : -1;
-            int col_step = (col_diff > 0) ? 1 : -1;
-            int pieces_count = 0;  // Счетчик встреченных шашек на пути
-            
-            // Проверка всех клеток между начальной и конечной позицией
-            for (int r = from_row + row_step, c = from_col + col_step; 
-                 r != to_row; 
-                 r += row_step, c += col_step) {
-                // Если встретили шашку
-                if (board[r][c].color != PieceColor::NONE) {
-                    // Нельзя перепрыгивать через свои шашки
-                    if (board[r][c].color == current_player) {
-                        return false;
-                    }
-                    // Нельзя перепрыгивать более одной шашки противника
-                    pieces_count++;
-                    if (pieces_count > 1) {
-                        return false;
-                    }
-                }
+            uint64_t us = chrono::duration_cast<chrono::microseconds>(Clock::now() - job.queued).count();
+            latency_us += us;
+            uint64_t prev = max_latency_us.load(memory_order_relaxed);
+            while (us > prev && !max_latency_us.compare_exchange_weak(prev, us)) {
             }
-            
-            return true;
+            ++done;
+            // Партия возвращается потоку команд до ответа: клиент может сразу слать следующий ход
+            session.busy.store(false, memory_order_release);
+            reply(line.str());
         }
     }
-    
-    // Метод для выполнения хода
-    bool makeMove(int from_row, int from_col, int to_row, int to_col) {
-        // Проверка валидности хода
-        if (!isValidMove(from_row, from_col, to_row, to_col)) {
-            return false;
+
+    // Партия из команды; при ошибке отвечает сам и возвращает nullptr
+    ServerSession* sessionFor(const string& token) {
+        ServerSession* session = sessions.find(strtoull(token.c_str(), nullptr, 10));
+        if (session == nullptr) {
+            replyError(token, "unknown-session");
+            return nullptr;
         }
-        
-        // Вычисление разницы между начальной и конечной позицией
-        int row_diff = to_row - from_row;
-        int col_diff = to_col - from_col;
-        
-        // Перемещение шашки на новую позицию
-        board[to_row][to_col] = board[from_row][from_col];
-        // Очистка старой позиции
-        board[from_row][from_col] = Piece(PieceColor::NONE);
-        
-        // Проверка на превращение в дамку
-        if (!board[to_row][to_col].is_king) {
-            // Белая шашка становится дамкой на первой строке (0)
-            // Черная шашка становится дамкой на последней строке (SIZE-1)
-            if ((current_player == PieceColor::WHITE && to_row == 0) || 
-                (current_player == PieceColor::BLACK && to_row == SIZE - 1)) {
-                board[to_row][to_col].is_king = true;
-                cout << "Шашка превратилась в дамку!" << endl;
+        if (session->busy.load(memory_order_acquire)) {
+            replyError(token, "busy");
+            return nullptr;
+        }
+        return session;
+    }
+
+    void commandNew(istringstream& args) {
+        string fen;
+        args >> fen;
+        CheckersBoard board;
+        if (!fen.empty() && !board.setPosition(fen)) {
+            replyError("-", "bad-fen");
+            return;
+        }
+        ServerSession* session = sessions.acquire();
+        if (session == nullptr) {
+            replyError("-", "too-many-sessions");
+            return;
+        }
+        session->board = board;
+        reply("new " + to_string(session->id));
+    }
+
+    void commandMove(istringstream& args) {
+        string token, text;
+        args >> token >> text;
+        ServerSession* session = sessionFor(token);
+        if (session == nullptr) {
+            return;
+        }
+        if (session->board.isGameOver()) {
+            replyError(token, "game-over");
+            return;
+        }
+        MoveList list;
+        session->board.generateMoves(list);
+        bool ambiguous;
+        const Move* move = parseMoveText(session->board, text, list, &ambiguous);
+        if (move == nullptr) {
+            // Взятие задано только начальной и конечной клетками, а таких взятий несколько
+            replyError(token, ambiguous ? "ambiguous-move" : "illegal-move");
+            return;
+        }
+        session->board.commitMove(*move);
+        reply("ok " + token);
+    }
+
+    void commandGo(istringstream& args) {
+        string token, key;
+        args >> token;
+        ServerSession* session = sessionFor(token);
+        if (session == nullptr) {
+            return;
+        }
+        if (session->board.isGameOver()) {
+            replyError(token, "game-over");
+            return;
+        }
+        Limits limits = options.limits;
+        uint64_t value;
+        while (args >> key >> value) {
+            if (key == "nodes") {
+                limits.max_nodes = value;
+            } else if (key == "time") {
+                limits.time_ms = int(min<uint64_t>(value, INT32_MAX));
+            } else if (key == "depth") {
+                limits.max_depth = int(min<uint64_t>(max<uint64_t>(value, 1), 64));
             }
         }
-        
-        // Обработка взятия шашки противника
-        if (abs(row_diff) == 2 || abs(row_diff) > 2) {
-            // Определение начальной и конечной позиции для поиска шашки противника
-            int start_row = (row_diff > 0) ? from_row + 1 : from_row - 1;
-            int end_row = (row_diff > 0) ? to_row - 1 : to_row + 1;
-            int start_col = (col_diff > 0) ? from_col + 1 : from_col - 1;
-            int end_col = (col_diff > 0) ? to_col - 1 : to_col + 1;
-            
-            // Поиск и удаление шашки противника между начальной и конечной позицией
-            for (int r = start_row, c = start_col; 
-                 (row_diff > 0) ? (r <= end_row) : (r >= end_row); 
-                 (row_diff > 0) ? r++ : r--) {
-                if (board[r][c].color != PieceColor::NONE && board[r][c].color != current_player) {
-                    // Удаление шашки противника
-                    board[r][c] = Piece(PieceColor::NONE);
-                    // Уменьшение счетчика шашек
-                    if (current_player == PieceColor::WHITE) {
-                        black_pieces--;
-                    } else {
-                        white_pieces--;
-                    }
-                    break;
-                }
-                // Движение по столбцу в зависимости от направления
-                (col_diff > 0) ? c++ : c--;
+        if (limits.time_ms <= 0 || limits.time_ms > options.max_time_ms) {
+            limits.time_ms = options.max_time_ms;
+        }
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            if (queue.size() >= options.max_queue) {
+                replyError(token, "overloaded");
+                return;
             }
+            session->busy.store(true, memory_order_relaxed);
+            queue.push_back({ session, session->id, limits, Clock::now() });
         }
-        
-        // Проверка окончания игры (когда у одного из игроков не осталось шашек)
-        if (white_pieces == 0 || black_pieces == 0) {
-            game_over = true;
-            cout << "Игра окончена! Победил " << 
-                (current_player == PieceColor::WHITE ? "белый" : "черный") << " игрок!" << endl;
+        queue_ready.notify_one();
+    }
+
+    void commandState(istringstream& args) {
+        string token;
+        args >> token;
+        ServerSession* session = sessionFor(token);
+        if (session != nullptr) {
+            reply("state " + token + " " + session->board.toFen() + " " + status(session->board));
+        }
+    }
+
+    void commandClose(istringstream& args) {
+        string token;
+        args >> token;
+        ServerSession* session = sessionFor(token);
+        if (session != nullptr) {
+            sessions.release(session);
+            reply("closed " + token);
+        }
+    }
+
+    void commandStats() {
+        size_t queued;
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            queued = queue.size();
+        }
+        uint64_t count = done;
+        ostringstream line;
+        line << fixed << setprecision(2) << "stats sessions " << sessions.size() << " queued " << queued
+             << " done " << count << " avg_ms " << (count > 0 ? latency_us / 1000.0 / count : 0.0)
+             << " max_ms " << max_latency_us / 1000.0;
+        reply(line.str());
+    }
+
+public:
+    explicit GameServer(const ServerOptions& server_options) : options(server_options) {
+    }
+
+    // Загрузка баз и книги; false, если книгу открыть не удалось
+    bool prepare() {
+        if (!options.tablebase_path.empty()) {
+            cerr << "Загружено разделов эндшпильных баз: " << tablebase.load(options.tablebase_path) << endl;
+        }
+        if (!options.book_file.empty() && !book.load(options.book_file)) {
+            cerr << "Не удалось загрузить книгу: " << options.book_file << endl;
+            return false;
         }
-        
-        // Смена текущего игрока
-        current_player = (current_player == PieceColor::WHITE) ? PieceColor::BLACK : PieceColor::WHITE;
         return true;
     }
-    
-    // Метод для выполнения хода компьютером
-    void makeComputerMove() {
-        vector<vector<int>> possible_moves;  // Вектор для хранения всех возможных ходов
-        
-        // Сначала ищем все возможные взятия
-        for (int from_row = 0; from_row < SIZE; ++from_row) {
-            for (int from_col = 0; from_col < SIZE; ++from_col) {
-                // Если нашли шашку текущего игрока
-                if (board[from_row][from_col].color == current_player) {
-                    // Проверяем все возможные конечные позиции
-                    for (int to_row = 0; to_row < SIZE; ++to_row) {
-                        for (int to_col = 0; to_col < SIZE; ++to_col) {
-                            // Если ход валиден и это взятие (ход через клетку)
-                            if (isValidMove(from_row, from_col, to_row, to_col) && 
-                                (abs(to_row - from_row) == 2 || abs(to_row - from_row) > 2)) {
-                                // Добавляем ход в список возможных
-                                possible_moves.push_back({from_row, from_col, to_row, to_col});
-                            }
-                        }
-                    }
-                }
+
+    // Обработка команд до quit или конца ввода
+    void run(istream& in) {
+        int count = options.workers > 0 ? options.workers : max(int(thread::hardware_concurrency()), 1);
+        vector<thread> workers;
+        for (int i = 0; i < count; ++i) {
+            engines.emplace_back(new Engine(options.hash_mb));
+            if (tablebase.maxPieces() > 0) {
+                engines.back()->setTablebase(&tablebase);
             }
+            engines.back()->setWeights(options.weights);
+            Engine* engine = engines.back().get();
+            workers.emplace_back([this, engine]() { workerLoop(*engine); });
         }
         
-        // Если не нашли взятий, ищем обычные ходы
-        if (possible_moves.empty()) {
-            for (int from_row = 0; from_row < SIZE; ++from_row) {
-                for (int from_col = 0; from_col < SIZE; ++from_col) {
-                    if (board[from_row][from_col].color == current_player) {
-                        for (int to_row = 0; to_row < SIZE; ++to_row) {
-                            for (int to_col = 0; to_col < SIZE; ++to_col) {
-                                if (isValidMove(from_row, from_col, to_row, to_col)) {
-                                    possible_moves.push_back({from_row, from_col, to_row, to_col});
-                                }
-                            }
-                        }
-                    }
-                }
+        string line;
+        bool quit = false;
+        while (!quit && getline(in, line)) {
+            istringstream args(line);
+            string command;
+            if (!(args >> command)) {
+                continue;
+            }
+            if (command == "new") {
+                commandNew(args);
+            } else if (command == "move") {
+                commandMove(args);
+            } else if (command == "go") {
+                commandGo(args);
+            } else if (command == "state") {
+                commandState(args);
+            } else if (command == "close") {
+                commandClose(args);
+            } else if (command == "stats") {
+                commandStats();
+            } else if (command == "quit") {
+                quit = true;
+            } else {
+                replyError("-", "unknown-command");
             }
         }
         
-        // Если нашли возможные ходы
-        if (!possible_moves.empty()) {
-            // Выбираем случайный ход из возможных
-            int random_index = rand() % possible_moves.size();
-            vector<int> move = possible_moves[random_index];
-            // Выполняем выбранный ход
-            makeMove(move[0], move[1], move[2], move[3]);
-            cout << "Компьютер сделал ход: " << move[0] << " " << move[1] << " " 
-                 << move[2] << " " << move[3] << endl;
+        // По quit очередь отбрасывается, а идущие поиски останавливаются;
+        // в конце ввода принятые запросы дорабатываются до конца
+        deque<Job> dropped;
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            if (quit) {
+                dropped.swap(queue);
+            }
+            stopping = true;
+        }
+        queue_ready.notify_all();
+        if (quit) {
+            for (const auto& engine : engines) {
+                engine->stop();
+            }
+        }
+        for (const Job& job : dropped) {
+            replyError(to_string(job.id), "shutdown");
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
+    }
+};
+
+int runServerMode(int argc, char* argv[]) {
+    ServerOptions options;
+    options.limits.max_nodes = 20000;
+    for (int i = 0; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        const char* value = argv[i + 1];
+        if (arg == "--workers") {
+            options.workers = atoi(value);
+        } else if (arg == "--hash") {
+            options.hash_mb = strtoul(value, nullptr, 10);
+        } else if (arg == "--nodes") {
+            options.limits.max_nodes = strtoull(value, nullptr, 10);
+        } else if (arg == "--depth") {
+            options.limits.max_depth = max(atoi(value), 1);
+        } else if (arg == "--max-time") {
+            options.max_time_ms = max(atoi(value), 1);
+        } else if (arg == "--queue") {
+            options.max_queue = max<size_t>(strtoull(value, nullptr, 10), 1);
+        } else if (arg == "--tb-path") {
+            options.tablebase_path = value;
+        } else if (arg == "--book") {
+            options.book_file = value;
+        } else if (arg == "--eval") {
+            if (!options.weights.load(value)) {
+                cerr << "Не удалось загрузить веса оценки: " << value << endl;
+                return 1;
+            }
         } else {
-            // Если нет возможных ходов, игра заканчивается
-            game_over = true;
-            cout << "Нет возможных ходов. Игра окончена!" << endl;
+            cerr << "Неизвестный параметр сервера: " << arg << endl;
+            return 1;
         }
     }
     
-    // Геттер для текущего игрока
-    PieceColor getCurrentPlayer() const {
-        return current_player;
+    GameServer server(options);
+    if (!server.prepare()) {
+        return 1;
+    }
+    // cout пишут рабочие потоки под output_mutex; привязка cin к cout сбрасывала бы
+    // буфер из потока команд без блокировки
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+    server.run(cin);
+    return 0;
+}
+
+// ========== КОНСОЛЬНЫЙ ИНТЕРФЕЙС ==========
+// Метод для отображения доски в консоли
+void printBoard(const CheckersBoard& board) {
+    // Вывод номеров столбцов
+    cout << "  ";
+    for (int col = 0; col < BOARD_SIZE; ++col) {
+        cout << col << " ";
     }
+    cout << endl;
     
-    // Геттер для типа текущего игрока (человек/компьютер)
-    PlayerType getCurrentPlayerType() const {
-        return (current_player == PieceColor::WHITE) ? white_player : black_player;
+    // Вывод каждой строки доски
+    for (int row = 0; row < BOARD_SIZE; ++row) {
+        cout << row << " ";  // Номер строки
+        for (int col = 0; col < BOARD_SIZE; ++col) {
+            Piece piece = board.pieceAt(row, col);
+            // Вывод символа для белой шашки
+            if (piece.color == PieceColor::WHITE) {
+                cout << (piece.is_king ? "W " : "w ");
+            } 
+            // Вывод символа для черной шашки
+            else if (piece.color == PieceColor::BLACK) {
+                cout << (piece.is_king ? "B " : "b ");
+            } 
+            // Вывод символа для пустой клетки
+            else {
+                cout << ". ";
+            }
+        }
+        cout << endl;
+    }
+}
+
+// Вывод событий партии в консоль
+class ConsoleObserver : public GameObserver {
+private:
+    ostream* profile_log;       // Журнал профиля поиска (может отсутствовать)
+    GameProfile profile{1};
+    int plies = 0;              // Сделано полуходов
+
+public:
+    explicit ConsoleObserver(ostream* profile_out = nullptr) : profile_log(profile_out) {
+    }
+
+    void onMove(const CheckersBoard&, const Move&, PieceColor) override {
+        ++plies;
+    }
+
+    void onPromotion(const CheckersBoard&, const Move&) override {
+        cout << "Шашка превратилась в дамку!" << endl;
     }
     
-    // Геттер для проверки окончания игры
-    bool isGameOver() const {
-        return game_over;
+    void onComputerMove(const CheckersBoard&, const Move& move, const SearchResult& result) override {
+        if (profile_log != nullptr) {
+            profile.addMove(plies + 1, move, result);
+            *profile_log << profile.takeLines() << flush;
+        }
+        cout << "Компьютер сделал ход: " << squareRow(move.from) << " " << squareCol(move.from) << " " 
+             << squareRow(move.to) << " " << squareCol(move.to);
+        if (result.from_book) {
+            cout << " (из дебютной книги)" << endl;
+            return;
+        }
+        cout << " (глубина " << result.depth << ", оценка " << result.score
+             << ", узлов " << result.nodes << ", " << result.nps() << " узлов/с"
+             << ", попаданий в хеш " << int(result.ttHitRate() * 100) << "%"
+             << ", в базах " << result.tb_hits << ")" << endl;
+    }
+    
+    void onGameOver(const CheckersBoard& board) override {
+        if (profile_log != nullptr) {
+            PieceColor winner = board.getWinner();
+            *profile_log << profile.finish(winner == PieceColor::NONE ? "draw"
+                                           : winner == PieceColor::WHITE ? "white" : "black") << flush;
+        }
+        if (board.getWinner() == PieceColor::NONE) {
+            cout << "Игра окончена! Ничья: 15 ходов только дамками без взятий." << endl;
+        } else {
+            cout << "Игра окончена! Победил " << 
+                (board.getWinner() == PieceColor::WHITE ? "белый" : "черный") << " игрок!" << endl;
+        }
     }
 };
 
+// Выбор одного из взятий с общими начальной и конечной клетками
+void chooseCapture(CheckersBoard& game, const MoveList& candidates) {
+    cout << "Взятие неоднозначно, выберите путь:" << endl;
+    for (int i = 0; i < candidates.size(); ++i) {
+        vector<int> path;
+        game.capturePath(candidates[i], {}, path);
+        cout << i + 1 << ". " << squareRow(candidates[i].from) << " " << squareCol(candidates[i].from);
+        for (int square : path) {
+            cout << " -> " << squareRow(square) << " " << squareCol(square);
+        }
+        cout << endl;
+    }
+    int choice = 0;
+    cin >> choice;
+    if (choice >= 1 && choice <= candidates.size()) {
+        game.commitMove(candidates[choice - 1]);
+    } else {
+        cout << "Неверный выбор! Попробуйте снова." << endl;
+    }
+}
+
 // Функция для запуска игры
-void playCheckers() {
+void playCheckers(size_t hash_mb, int threads, const string& tablebase_path, const string& book_path,
+                  const EvalWeights& weights, const string& profile_path) {
     cout << "Выберите тип игры:" << endl;
     cout << "1. Игрок vs Компьютер" << endl;
     cout << "2. Игрок vs Игрок" << endl;
@@ -377,13 +4141,42 @@ void playCheckers() {
             black_player = PlayerType::COMPUTER;
     }
     
-    // Создание экземпляра игры
+    // Создание экземпляра игры и движка компьютера
     CheckersBoard game(white_player, black_player);
+    ofstream profile_log;
+    if (!profile_path.empty()) {
+        profile_log.open(profile_path);
+        if (!profile_log) {
+            cout << "Не удалось открыть журнал профиля: " << profile_path << endl;
+        }
+    }
+    ConsoleObserver console(profile_log.is_open() ? &profile_log : nullptr);
+    game.setObserver(&console);
+    Engine engine(hash_mb, threads);
+    engine.setWeights(weights);
+    Tablebase tablebase;
+    if (!tablebase_path.empty()) {
+        cout << "Загружено разделов эндшпильных баз: " << tablebase.load(tablebase_path) << endl;
+        if (tablebase.maxPieces() > 0) {
+            engine.setTablebase(&tablebase);
+        }
+    }
+    OpeningBook book;
+    if (!book_path.empty()) {
+        if (book.load(book_path)) {
+            // Каждая партия начинается по-своему
+            engine.setBook(&book, uint64_t(time(nullptr)));
+        } else {
+            cout << "Не удалось загрузить книгу: " << book_path << endl;
+        }
+    }
+    Limits limits;
+    limits.time_ms = 1000;  // Не более секунды на ход
     
     // Основной игровой цикл
     while (!game.isGameOver()) {
         // Отображение текущего состояния доски
-        game.printBoard();
+        printBoard(game);
         
         // Если текущий игрок - человек
         if (game.getCurrentPlayerType() == PlayerType::HUMAN) {
@@ -395,26 +4188,89 @@ void playCheckers() {
             
             // Попытка выполнить ход
             if (!game.makeMove(from_row, from_col, to_row, to_col)) {
-                cout << "Неверный ход! Попробуйте снова." << endl;
+                // Разные взятия с одними начальной и конечной клетками - путь выбирает игрок
+                MoveList list, candidates;
+                game.generateMoves(list);
+                game.movesBetween(list, squareIndex(from_row, from_col), squareIndex(to_row, to_col), candidates);
+                if (candidates.size() > 1) {
+                    chooseCapture(game, candidates);
+                } else {
+                    cout << "Неверный ход! Попробуйте снова." << endl;
+                }
             }
         } 
         // Если текущий игрок - компьютер
         else {
             cout << "Ход компьютера (" << 
                 (game.getCurrentPlayer() == PieceColor::WHITE ? "белые" : "черные") << ")..." << endl;
-            game.makeComputerMove();
+            game.makeComputerMove(engine, limits);
         }
     }
 }
 
 // Точка входа в программу
-int main() {
+int main(int argc, char* argv[]) {
     setlocale(LC_ALL, "Russian");  // Установка русской локали
+    
+    // Неинтерактивные режимы
+    if (argc > 1 && string(argv[1]) == "perft") {
+        return runPerft(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "tablebase") {
+        return runTablebaseMode(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "book") {
+        return runBookMode(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "dataset") {
+        return runDatasetMode(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "tune") {
+        return runTuneMode(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "match") {
+        return runMatchMode(argc - 2, argv + 2);
+    }
+    if (argc > 1 && string(argv[1]) == "server") {
+        return runServerMode(argc - 2, argv + 2);
+    }
+    
     cout << "Добро пожаловать в игру Шашки!" << endl;
     cout << "Вводите ходы в формате: from_row from_col to_row to_col" << endl;
     cout << "Например: 5 0 4 1 - ход из клетки (5,0) в (4,1)" << endl;
     
-    playCheckers();  // Запуск игры
+    // Параметры запуска: --hash N - размер таблицы транспозиций в мегабайтах,
+    // --threads N - число потоков поиска, --tb-path DIR - каталог эндшпильных баз,
+    // --book FILE - дебютная книга, --eval FILE - веса оценки позиции,
+    // --profile FILE - журнал профиля поиска
+    size_t hash_mb = DEFAULT_HASH_MB;
+    int threads = 1;
+    string tablebase_path;
+    string book_path;
+    string profile_path;
+    EvalWeights weights;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--hash" && i + 1 < argc) {
+            hash_mb = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--tb-path" && i + 1 < argc) {
+            tablebase_path = argv[++i];
+        } else if (arg == "--book" && i + 1 < argc) {
+            book_path = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (arg == "--eval" && i + 1 < argc) {
+            const char* path = argv[++i];
+            if (!weights.load(path)) {
+                cout << "Не удалось загрузить веса оценки: " << path << endl;
+                return 1;
+            }
+        }
+    }
+    
+    playCheckers(hash_mb, threads, tablebase_path, book_path, weights, profile_path);  // Запуск игры
     
     return 0;
 }
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Локальный клиент сервера партий (режим server).
+
+Запускает сервер, открывает --games партий, играет их до конца ходами движка
+(go) и закрывает. Все партии идут одновременно: новый go по партии
+отправляется сразу после ответа на предыдущий. В конце печатает итоги партий,
+число ходов в секунду и строку stats сервера.
+
+Пример: python3 tools/server_client.py ./Shashki --games 5000 --nodes 200 --queue 100000
+"""
+
+import argparse
+import subprocess
+import sys
+import time
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Нагрузочный клиент сервера партий")
+    parser.add_argument("binary", help="исполняемый файл Shashki")
+    parser.add_argument("--games", type=int, default=1000, help="партий одновременно")
+    parser.add_argument("--nodes", type=int, default=500, help="узлов на ход")
+    parser.add_argument("--max-plies", type=int, default=150, help="предел длины партии")
+    parser.add_argument("--workers", type=int, default=0, help="рабочих потоков сервера (0 - по числу ядер)")
+    parser.add_argument("--hash", type=int, default=4, help="МБ таблицы на рабочий поток")
+    parser.add_argument("--queue", type=int, default=4096, help="предел очереди сервера")
+    args = parser.parse_args()
+
+    server = subprocess.Popen(
+        [args.binary, "server", "--workers", str(args.workers), "--hash", str(args.hash),
+         "--queue", str(args.queue)],
+        stdin=subprocess.PIPE, stdout=subprocess.PIPE, text=True, bufsize=1)
+
+    def send(line):
+        server.stdin.write(line + "\n")
+        server.stdin.flush()
+
+    def receive():
+        line = server.stdout.readline()
+        if not line:
+            sys.exit("сервер завершился")
+        return line.split()
+
+    games = []
+    for _ in range(args.games):
+        send("new")
+        games.append(receive()[1])
+
+    go = "go {} nodes " + str(args.nodes)
+    plies = dict.fromkeys(games, 0)
+    results = {}
+    retries = []           # Партии, получившие overloaded: go повторяется позже
+    moves = 0
+    live = len(games)
+    start = time.time()
+    for game in games:
+        send(go.format(game))
+    while live:
+        reply = receive()
+        kind, game = reply[0], reply[1]
+        if kind == "bestmove":
+            moves += 1
+            plies[game] += 1
+            if reply[2] == "none" or plies[game] >= args.max_plies:
+                send("state " + game)
+            else:
+                send(go.format(game))
+            # Ответ освободил место в очереди
+            if retries:
+                send(go.format(retries.pop()))
+        elif kind == "error" and reply[2] == "overloaded":
+            retries.append(game)
+        elif kind == "error" and reply[2] == "game-over":
+            send("state " + game)
+        elif kind == "state":
+            results[reply[3]] = results.get(reply[3], 0) + 1
+            live -= 1
+            send("close " + game)
+        elif kind == "closed":
+            pass
+        else:
+            sys.exit("неожиданный ответ: " + " ".join(reply))
+    seconds = time.time() - start
+
+    send("stats")
+    while True:
+        reply = receive()
+        if reply[0] == "stats":
+            break
+    send("quit")
+    server.wait()
+
+    print("Партий: {}, ходов: {}, {:.0f} ходов/с".format(len(games), moves, moves / seconds))
+    print("Итоги:", " ".join("{} {}".format(name, count) for name, count in sorted(results.items())))
+    print(" ".join(reply))
+
+
+if __name__ == "__main__":
+    main()